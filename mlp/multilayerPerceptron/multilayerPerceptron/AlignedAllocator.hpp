@@ -0,0 +1,76 @@
+//
+//  AlignedAllocator.hpp
+//  multilayerPerceptron
+//
+//  Created by Brian Desnoyers on 2/22/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef AlignedAllocator_hpp
+#define AlignedAllocator_hpp
+
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+// The alignment used for contiguous numeric buffers- one cache line
+const size_t BUFFER_ALIGNMENT = 64;
+
+/**
+ A std::vector allocator that aligns its buffer to `Alignment` bytes, so rows
+ padded to a multiple of the alignment all start on a cache line boundary.
+ */
+template <typename T, size_t Alignment = BUFFER_ALIGNMENT>
+class AlignedAllocator {
+public:
+  typedef T value_type;
+  
+  template <typename U>
+  struct rebind {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+  
+  AlignedAllocator() {}
+  
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+  
+  T *allocate(size_t n) {
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, Alignment, n * sizeof(T)) != 0) {
+      throw bad_alloc();
+    }
+    return (T *)buffer;
+  }
+  
+  void deallocate(T *buffer, size_t) {
+    free(buffer);
+  }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) {
+  return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) {
+  return false;
+}
+
+/**
+ Rounds a row length up so every row of a matrix stays aligned.
+ 
+ @param length the number of elements in a row
+ @return the padded row length
+ */
+template <typename T>
+size_t alignedStride(size_t length) {
+  size_t perLine = BUFFER_ALIGNMENT / sizeof(T);
+  return (length + perLine - 1) / perLine * perLine;
+}
+
+#endif /* AlignedAllocator_hpp */
@@ -7,9 +7,13 @@
 //
 
 #include "Perceptron.hpp"
+#include <algorithm>
 #include <math.h>
 #include <assert.h>
 #include <iostream>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -50,6 +54,178 @@ uniform_real_distribution<double> distForWeights(int inputNodes, int outputNodes
   return uniform_real_distribution<double>(lowerBound, upperBound);
 }
 
+// The register tile of `multiplyMatrices`: GEMM_MR rows by GEMM_NR columns
+const int GEMM_MR = 4;
+const int GEMM_NR = 8;
+
+// The cache blocks of `multiplyMatrices`: a GEMM_MC x GEMM_KC block of A
+// stays in L2 while it's multiplied by GEMM_KC x GEMM_NR slabs of B from L1
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 64;
+const size_t GEMM_NC = 256;
+
+/**
+ Copies rows [i0, i0 + mc) and columns [k0, k0 + kc) of op(A) into `packed`
+ in slabs of GEMM_MR rows, column-major within a slab, padded w/ 0 rows.
+ op(A) is A, or A^T if `transpose`.
+ */
+void packA(const double *a, size_t lda, bool transpose, size_t i0, size_t mc, size_t k0, size_t kc, double *packed) {
+  for (size_t s = 0; s < mc; s += GEMM_MR) {
+    double *slab = packed + s * kc;
+    for (size_t k = 0; k < kc; k++) {
+      for (int t = 0; t < GEMM_MR; t++) {
+        size_t i = i0 + s + t;
+        if (s + t >= mc) {
+          slab[k * GEMM_MR + t] = 0;
+        } else if (transpose) {
+          slab[k * GEMM_MR + t] = a[(k0 + k) * lda + i];
+        } else {
+          slab[k * GEMM_MR + t] = a[i * lda + k0 + k];
+        }
+      }
+    }
+  }
+}
+
+/**
+ Copies rows [k0, k0 + kc) and columns [j0, j0 + nc) of op(B) into `packed`
+ in slabs of GEMM_NR columns, row-major within a slab, padded w/ 0 columns.
+ op(B) is B, or B^T if `transpose`.
+ */
+void packB(const double *b, size_t ldb, bool transpose, size_t k0, size_t kc, size_t j0, size_t nc, double *packed) {
+  for (size_t s = 0; s < nc; s += GEMM_NR) {
+    double *slab = packed + s * kc;
+    for (size_t k = 0; k < kc; k++) {
+      for (int t = 0; t < GEMM_NR; t++) {
+        size_t j = j0 + s + t;
+        if (s + t >= nc) {
+          slab[k * GEMM_NR + t] = 0;
+        } else if (transpose) {
+          slab[k * GEMM_NR + t] = b[j * ldb + k0 + k];
+        } else {
+          slab[k * GEMM_NR + t] = b[(k0 + k) * ldb + j];
+        }
+      }
+    }
+  }
+}
+
+/**
+ Multiplies a packed slab of GEMM_MR rows by a packed slab of GEMM_NR
+ columns over `kc`, and adds the top left `mr` x `nr` of the product to `c`,
+ whose rows are `ldc` apart.
+ */
+void multiplyTile(size_t kc, const double *a, const double *b, double *c, size_t ldc, int mr, int nr) {
+  double tile[GEMM_MR * GEMM_NR];
+#if defined(__AVX__)
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  for (size_t k = 0; k < kc; k++) {
+    __m256d b0 = _mm256_loadu_pd(b + k * GEMM_NR);
+    __m256d b1 = _mm256_loadu_pd(b + k * GEMM_NR + 4);
+    __m256d a0 = _mm256_broadcast_sd(a + k * GEMM_MR);
+    c00 = _mm256_add_pd(c00, _mm256_mul_pd(a0, b0));
+    c01 = _mm256_add_pd(c01, _mm256_mul_pd(a0, b1));
+    __m256d a1 = _mm256_broadcast_sd(a + k * GEMM_MR + 1);
+    c10 = _mm256_add_pd(c10, _mm256_mul_pd(a1, b0));
+    c11 = _mm256_add_pd(c11, _mm256_mul_pd(a1, b1));
+    __m256d a2 = _mm256_broadcast_sd(a + k * GEMM_MR + 2);
+    c20 = _mm256_add_pd(c20, _mm256_mul_pd(a2, b0));
+    c21 = _mm256_add_pd(c21, _mm256_mul_pd(a2, b1));
+    __m256d a3 = _mm256_broadcast_sd(a + k * GEMM_MR + 3);
+    c30 = _mm256_add_pd(c30, _mm256_mul_pd(a3, b0));
+    c31 = _mm256_add_pd(c31, _mm256_mul_pd(a3, b1));
+  }
+  _mm256_storeu_pd(tile, c00);
+  _mm256_storeu_pd(tile + 4, c01);
+  _mm256_storeu_pd(tile + 8, c10);
+  _mm256_storeu_pd(tile + 12, c11);
+  _mm256_storeu_pd(tile + 16, c20);
+  _mm256_storeu_pd(tile + 20, c21);
+  _mm256_storeu_pd(tile + 24, c30);
+  _mm256_storeu_pd(tile + 28, c31);
+#elif defined(__SSE2__)
+  // One row of the tile at a time, in 4 registers
+  for (int r = 0; r < GEMM_MR; r++) {
+    __m128d c0 = _mm_setzero_pd();
+    __m128d c1 = _mm_setzero_pd();
+    __m128d c2 = _mm_setzero_pd();
+    __m128d c3 = _mm_setzero_pd();
+    for (size_t k = 0; k < kc; k++) {
+      __m128d ar = _mm_set1_pd(a[k * GEMM_MR + r]);
+      const double *bk = b + k * GEMM_NR;
+      c0 = _mm_add_pd(c0, _mm_mul_pd(ar, _mm_loadu_pd(bk)));
+      c1 = _mm_add_pd(c1, _mm_mul_pd(ar, _mm_loadu_pd(bk + 2)));
+      c2 = _mm_add_pd(c2, _mm_mul_pd(ar, _mm_loadu_pd(bk + 4)));
+      c3 = _mm_add_pd(c3, _mm_mul_pd(ar, _mm_loadu_pd(bk + 6)));
+    }
+    _mm_storeu_pd(tile + r * GEMM_NR, c0);
+    _mm_storeu_pd(tile + r * GEMM_NR + 2, c1);
+    _mm_storeu_pd(tile + r * GEMM_NR + 4, c2);
+    _mm_storeu_pd(tile + r * GEMM_NR + 6, c3);
+  }
+#else
+  fill(tile, tile + GEMM_MR * GEMM_NR, 0.0);
+  for (size_t k = 0; k < kc; k++) {
+    for (int r = 0; r < GEMM_MR; r++) {
+      for (int col = 0; col < GEMM_NR; col++) {
+        tile[r * GEMM_NR + col] += a[k * GEMM_MR + r] * b[k * GEMM_NR + col];
+      }
+    }
+  }
+#endif
+  for (int r = 0; r < mr; r++) {
+    for (int col = 0; col < nr; col++) {
+      c[r * ldc + col] += tile[r * GEMM_NR + col];
+    }
+  }
+}
+
+/**
+ Calculates C = op(A) op(B) for row-major matrices as a cache-blocked
+ matrix multiply, where op(A) is m x k, op(B) is k x n and C is m x n. Blocks
+ of both operands are packed so they're read w/ unit stride (transposing
+ them on the way), and a GEMM_MR x GEMM_NR tile of C is built in registers.
+ 
+ @param transposeA whether op(A) is A^T
+ @param transposeB whether op(B) is B^T
+ @param m          the number of rows of C
+ @param n          the number of columns of C
+ @param k          the inner dimension
+ @param a          the 1st matrix
+ @param lda        the distance between rows of `a`
+ @param b          the 2nd matrix
+ @param ldb        the distance between rows of `b`
+ @param c          the product
+ @param ldc        the distance between rows of `c`
+ @param packed     scratch space of at least (GEMM_MC + GEMM_NC) * GEMM_KC values
+ */
+void multiplyMatrices(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, const double *a, size_t lda, const double *b, size_t ldb, double *c, size_t ldc, double *packed) {
+  for (size_t i = 0; i < m; i++) {
+    fill(c + i * ldc, c + i * ldc + n, 0.0);
+  }
+  double *packedA = packed;
+  double *packedB = packed + GEMM_MC * GEMM_KC;
+  for (size_t jc = 0; jc < n; jc += GEMM_NC) {
+    size_t nc = min(GEMM_NC, n - jc);
+    for (size_t pc = 0; pc < k; pc += GEMM_KC) {
+      size_t kc = min(GEMM_KC, k - pc);
+      packB(b, ldb, transposeB, pc, kc, jc, nc, packedB);
+      for (size_t ic = 0; ic < m; ic += GEMM_MC) {
+        size_t mc = min(GEMM_MC, m - ic);
+        packA(a, lda, transposeA, ic, mc, pc, kc, packedA);
+        for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+          for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+            multiplyTile(kc, packedA + ir * kc, packedB + jr * kc, c + (ic + ir) * ldc + jc + jr, ldc, (int)min((size_t)GEMM_MR, mc - ir), (int)min((size_t)GEMM_NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
 SHLMLP::SHLMLP(int inputNodes, int outputNodes, int hiddenNodes, double learningRate, double momentum, double leastMeanSquareError) {
   this->inputNodes = inputNodes;
   this->outputNodes = outputNodes;
@@ -58,67 +234,113 @@ SHLMLP::SHLMLP(int inputNodes, int outputNodes, int hiddenNodes, double learning
   this->learningRate = learningRate;
   this->leastMeanSquareError = leastMeanSquareError;
   this->momentum = momentum;
+  this->batchSize = 1;
   
   // Set-up random number generator for generating weights
   random_device seedGenerator;
   mt19937_64 mersenneTwisterGenerator{seedGenerator()};
   
+  // Each layer's weights are one aligned buffer, w/ a padded row per node
+  // of the layer before it (the padding stays 0)
+  this->hiddenStride = alignedStride<double>(this->hiddenNodes);
+  this->outputStride = alignedStride<double>(this->outputNodes);
+  this->inputToHiddenWeights.assign(this->inputNodes * this->hiddenStride, 0.0);
+  this->hiddenToOutputWeights.assign(this->hiddenNodes * this->outputStride, 0.0);
+  this->inputToHiddenVelocity.assign(this->inputToHiddenWeights.size(), 0.0);
+  this->hiddenToOutputVelocity.assign(this->hiddenToOutputWeights.size(), 0.0);
+  
   // Initialize weights from inputs to hidden layer
   uniform_real_distribution<double> inpToHidDist = distForWeights(this->inputNodes, this->hiddenNodes);
   for (int imp = 0; imp < inputNodes; imp++) {
-    vector<double> weightsFromImpI;
+    double *weightsFromImpI = this->inputToHiddenWeights.data() + imp * this->hiddenStride;
     for (int hid = 0; hid < hiddenNodes; hid++) {
-      weightsFromImpI.push_back(inpToHidDist(mersenneTwisterGenerator));
+      weightsFromImpI[hid] = inpToHidDist(mersenneTwisterGenerator);
     }
-    this->inputToHiddenWeights.push_back(weightsFromImpI);
   }
   
   // Initialize weights from hidden to output layer
   uniform_real_distribution<double> hidToOutDist = distForWeights(this->hiddenNodes, this->outputNodes);
   for (int hid = 0; hid < hiddenNodes; hid++) {
-    vector<double> weightsFromHidI;
+    double *weightsFromHidI = this->hiddenToOutputWeights.data() + hid * this->outputStride;
     for (int out = 0; out < outputNodes; out++) {
-      weightsFromHidI.push_back(hidToOutDist(mersenneTwisterGenerator));
+      weightsFromHidI[out] = hidToOutDist(mersenneTwisterGenerator);
     }
-    this->hiddenToOutputWeights.push_back(weightsFromHidI);
   }
   
   // Resize vectors for holding node values
   // Note that bias vectors are not initalized (0)
-  this->inputNodeValues.resize(this->inputNodes);
+  this->activeInputs.reserve(this->inputNodes);
+  this->activeInputValues.reserve(this->inputNodes);
   this->hiddenNodeValues.resize(this->hiddenNodes);
   this->hiddenLayerBias.resize(this->hiddenNodes);
   this->outputNodeValues.resize(this->outputNodes);
   this->outputLayerBias.resize(this->outputNodes);
 }
 
+void SHLMLP::setInputs(const vector<int> &x) {
+  assert(x.size() == this->inputNodes);
+  this->activeInputs.clear();
+  this->activeInputValues.clear();
+  for (int inp = 0; inp < this->inputNodes; inp++) {
+    if (x[inp] != 0) {
+      this->activeInputs.push_back(inp);
+      this->activeInputValues.push_back(x[inp]);
+    }
+  }
+}
+
+void SHLMLP::catchUpInputWeights(int inp, size_t steps) {
+  if (steps == 0) {
+    return;
+  }
+  // After k updates w/o a gradient, the velocity v has decayed to
+  // momentum^k v and the weights have moved by (momentum + ... + momentum^k) v
+  double decay = pow(this->momentum, (double)steps);
+  double moved = (this->momentum == 1) ? steps : this->momentum * (1 - decay) / (1 - this->momentum);
+  double *weights = this->inputToHiddenWeights.data() + inp * this->hiddenStride;
+  double *velocity = this->inputToHiddenVelocity.data() + inp * this->hiddenStride;
+  for (int hid = 0; hid < this->hiddenNodes; hid++) {
+    weights[hid] += moved * velocity[hid];
+    velocity[hid] *= decay;
+  }
+}
+
 void SHLMLP::updateNodeValues() {
-  // Calculate hidden layer node values
-  for (int hiddenNodeIndex = 0; hiddenNodeIndex < this->hiddenNodes; hiddenNodeIndex++) {
-    this->hiddenNodeValues[hiddenNodeIndex] = 0;
-    for (int inputNodeIndex = 0; inputNodeIndex < this->inputNodes; inputNodeIndex++) {
-      this->hiddenNodeValues[hiddenNodeIndex] += this->inputNodeValues[inputNodeIndex] * this->inputToHiddenWeights[inputNodeIndex][hiddenNodeIndex];
+  // Calculate hidden layer node values- each active input node adds its row
+  // of weights, scaled by its value, to every hidden node at once
+  double *hidden = this->hiddenNodeValues.data();
+  fill(hidden, hidden + this->hiddenNodes, 0.0);
+  for (int a = 0; a < this->activeInputs.size(); a++) {
+    double value = this->activeInputValues[a];
+    const double *weights = this->inputToHiddenWeights.data() + this->activeInputs[a] * this->hiddenStride;
+    for (int hiddenNodeIndex = 0; hiddenNodeIndex < this->hiddenNodes; hiddenNodeIndex++) {
+      hidden[hiddenNodeIndex] += value * weights[hiddenNodeIndex];
     }
-    
+  }
+  for (int hiddenNodeIndex = 0; hiddenNodeIndex < this->hiddenNodes; hiddenNodeIndex++) {
     // Add bias
-    this->hiddenNodeValues[hiddenNodeIndex] += hiddenLayerBias[hiddenNodeIndex];
+    hidden[hiddenNodeIndex] += hiddenLayerBias[hiddenNodeIndex];
     
     // Perform activation function (sigmoid)
-    this->hiddenNodeValues[hiddenNodeIndex] = sigmoid(this->hiddenNodeValues[hiddenNodeIndex]);
+    hidden[hiddenNodeIndex] = sigmoid(hidden[hiddenNodeIndex]);
   }
   
-  // Calculate output node values
-  for (int outputNodeIndex = 0; outputNodeIndex < this->outputNodes; outputNodeIndex++) {
-    this->outputNodeValues[outputNodeIndex] = 0;
-    for (int hiddenNodeIndex = 0; hiddenNodeIndex < this->hiddenNodes; hiddenNodeIndex++) {
-      this->outputNodeValues[outputNodeIndex] += this->hiddenNodeValues[hiddenNodeIndex] * this->hiddenToOutputWeights[hiddenNodeIndex][outputNodeIndex];
+  // Calculate output node values the same way from the hidden layer
+  double *output = this->outputNodeValues.data();
+  fill(output, output + this->outputNodes, 0.0);
+  for (int hiddenNodeIndex = 0; hiddenNodeIndex < this->hiddenNodes; hiddenNodeIndex++) {
+    double value = hidden[hiddenNodeIndex];
+    const double *weights = this->hiddenToOutputWeights.data() + hiddenNodeIndex * this->outputStride;
+    for (int outputNodeIndex = 0; outputNodeIndex < this->outputNodes; outputNodeIndex++) {
+      output[outputNodeIndex] += value * weights[outputNodeIndex];
     }
-    
+  }
+  for (int outputNodeIndex = 0; outputNodeIndex < this->outputNodes; outputNodeIndex++) {
     // Add bias
-    this->outputNodeValues[outputNodeIndex] += outputLayerBias[outputNodeIndex];
+    output[outputNodeIndex] += outputLayerBias[outputNodeIndex];
     
     // Perform activation function (sigmoid)
-    this->outputNodeValues[outputNodeIndex] = sigmoid(this->outputNodeValues[outputNodeIndex]);
+    output[outputNodeIndex] = sigmoid(output[outputNodeIndex]);
   }
 }
 
@@ -131,10 +353,31 @@ void SHLMLP::train(vector<vector<int>> x, vector<int> y) {
   double outputLayerDelta[this->outputNodes];
   double hiddenLayerDelta[this->hiddenNodes];
   
-  vector<vector<double>> tempIHWeights = this->inputToHiddenWeights;
-  vector<vector<double>> tempHOWeights = this->hiddenToOutputWeights;
-  vector<vector<double>> prevIHWeights = this->inputToHiddenWeights;
-  vector<vector<double>> prevHOWeights = this->hiddenToOutputWeights;
+  // The momentum term is the last change of each weight, which starts at 0
+  fill(this->inputToHiddenVelocity.begin(), this->inputToHiddenVelocity.end(), 0.0);
+  fill(this->hiddenToOutputVelocity.begin(), this->hiddenToOutputVelocity.end(), 0.0);
+  if (this->batchSize > 1) {
+    this->trainMiniBatches(x, y);
+    return;
+  }
+  
+  // The active input nodes of every sample, as one list w/ where each
+  // sample's part starts
+  vector<size_t> sampleStart(1, 0);
+  vector<int> sampleInputs;
+  vector<int> sampleValues;
+  for (int s = 0; s < x.size(); s++) {
+    this->setInputs(x[s]);
+    sampleInputs.insert(sampleInputs.end(), this->activeInputs.begin(), this->activeInputs.end());
+    sampleValues.insert(sampleValues.end(), this->activeInputValues.begin(), this->activeInputValues.end());
+    sampleStart.push_back(sampleInputs.size());
+  }
+  
+  // An input node's weights only get a gradient from the samples it's active
+  // in. In between, they're only moved by momentum, which is applied all at
+  // once when the node is next active (see `catchUpInputWeights`).
+  size_t step = 0; // The # of samples trained on
+  vector<size_t> lastInputUpdate(this->inputNodes, 0); // The step each input node's weights are current as of
   
   do {
     // Reset the mean square error
@@ -142,8 +385,14 @@ void SHLMLP::train(vector<vector<int>> x, vector<int> y) {
     
     // Iterate across samples
     for (int s = 0; s < x.size(); s++) {
-      // Populate input node values from sample s, and then forward propagate
-      this->inputNodeValues = x[s];
+      // Populate input node values from sample s, bring their weights up to
+      // date, and then forward propagate
+      this->activeInputs.assign(sampleInputs.begin() + sampleStart[s], sampleInputs.begin() + sampleStart[s + 1]);
+      this->activeInputValues.assign(sampleValues.begin() + sampleStart[s], sampleValues.begin() + sampleStart[s + 1]);
+      for (int inp : this->activeInputs) {
+        this->catchUpInputWeights(inp, step - lastInputUpdate[inp]);
+      }
+      step++;
       this->updateNodeValues();
       
       // Back-propagation
@@ -161,57 +410,180 @@ void SHLMLP::train(vector<vector<int>> x, vector<int> y) {
       
       // Find delta of hidden layer
       for (int hid = 0; hid < hiddenNodes; hid++) {
+        const double *weights = this->hiddenToOutputWeights.data() + hid * this->outputStride;
         hiddenLayerDelta[hid] = 0;
         for (int out = 0; out < outputNodes; out++) {
           // Our delta is proportional to the "blame" for the result in the output layer
-          hiddenLayerDelta[hid] += outputLayerDelta[out] * hiddenToOutputWeights[hid][out];
+          hiddenLayerDelta[hid] += outputLayerDelta[out] * weights[out];
         }
       }
       
       // Weight update step
-      tempIHWeights = this->inputToHiddenWeights;
-      tempHOWeights = this->hiddenToOutputWeights;
-      
       // Multiply by derivative- per chain rule
       for (int hid = 0; hid < hiddenNodes; hid++) {
         hiddenLayerDelta[hid] *= derSigmoid(hiddenNodeValues[hid]);
       }
       
-      // Update the input layer -> hidden layer weights
-      for (int hid = 0; hid < this->hiddenNodes; hid++) {
-        for (int inp = 0; inp < this->inputNodes; inp++) {
-          this->inputToHiddenWeights[inp][hid] += this->momentum * (this->inputToHiddenWeights[inp][hid] - prevIHWeights[inp][hid]) + this->learningRate * hiddenLayerDelta[hid] * this->inputNodeValues[inp];
+      // Update the input layer -> hidden layer weights, one active input's row
+      // at a time- the others have no gradient
+      for (int a = 0; a < this->activeInputs.size(); a++) {
+        int inp = this->activeInputs[a];
+        double *weights = this->inputToHiddenWeights.data() + inp * this->hiddenStride;
+        double *velocity = this->inputToHiddenVelocity.data() + inp * this->hiddenStride;
+        double input = this->activeInputValues[a];
+        for (int hid = 0; hid < this->hiddenNodes; hid++) {
+          velocity[hid] = this->momentum * velocity[hid] + this->learningRate * hiddenLayerDelta[hid] * input;
+          weights[hid] += velocity[hid];
         }
+        lastInputUpdate[inp] = step;
+      }
+      for (int hid = 0; hid < this->hiddenNodes; hid++) {
         // Update the hidden layer bias
         // Conceptually, bias is a node that always outputs 1.
         // (We won't use the momentum term to update bias here.)
         hiddenLayerBias[hid] += this->learningRate * hiddenLayerDelta[hid] * 1;
       }
       
-      // Update the hidden layer -> output layer weights
-      for (int out = 0; out < outputNodes; out++) {
-        for (int hid = 0; hid < hiddenNodes; hid++) {
-          this->hiddenToOutputWeights[hid][out] += this->momentum * (this->hiddenToOutputWeights[hid][out] - prevHOWeights[hid][out]) + this->learningRate * outputLayerDelta[out] * this->hiddenNodeValues[hid];
+      // Update the hidden layer -> output layer weights, one hidden node's row at a time
+      for (int hid = 0; hid < hiddenNodes; hid++) {
+        double *weights = this->hiddenToOutputWeights.data() + hid * this->outputStride;
+        double *velocity = this->hiddenToOutputVelocity.data() + hid * this->outputStride;
+        for (int out = 0; out < outputNodes; out++) {
+          velocity[out] = this->momentum * velocity[out] + this->learningRate * outputLayerDelta[out] * this->hiddenNodeValues[hid];
+          weights[out] += velocity[out];
         }
+      }
+      for (int out = 0; out < outputNodes; out++) {
         // Update the output layer bias
         // Conceptually, bias is a node that always outputs 1.
         // (We won't use the momentum term to update bias here.)
         outputLayerBias[out] += this->learningRate * outputLayerDelta[out] * 1;
       }
       
-      prevIHWeights = tempIHWeights;
-      prevHOWeights = tempHOWeights;
-      
       meanSquareError += errorSquared / (outputNodes + 1);
       errorSquared = 0;
     }
     cout << "Epoch " << currentEpoch << ": MSE = " << meanSquareError << endl;
     currentEpoch++; // increment epoch
   } while (meanSquareError >= (this->leastMeanSquareError + 0.0001));
+  
+  // Bring every input node's weights up to date
+  for (int inp = 0; inp < this->inputNodes; inp++) {
+    this->catchUpInputWeights(inp, step - lastInputUpdate[inp]);
+  }
+}
+
+void SHLMLP::trainMiniBatches(const vector<vector<int>> &x, const vector<int> &y) {
+  size_t batch = this->batchSize;
+  size_t inputs = this->inputNodes;
+  
+  // Every activation and gradient of a batch, one row per sample in the same
+  // layout as the weights, allocated once
+  vector<double, AlignedAllocator<double>> batchInputs(batch * inputs);
+  vector<double, AlignedAllocator<double>> batchHidden(batch * this->hiddenStride);
+  vector<double, AlignedAllocator<double>> batchOutput(batch * this->outputStride);
+  vector<double, AlignedAllocator<double>> hiddenDeltas(batch * this->hiddenStride);
+  vector<double, AlignedAllocator<double>> outputDeltas(batch * this->outputStride);
+  vector<double, AlignedAllocator<double>> inputToHiddenGradient(this->inputToHiddenWeights.size());
+  vector<double, AlignedAllocator<double>> hiddenToOutputGradient(this->hiddenToOutputWeights.size());
+  vector<double, AlignedAllocator<double>> packed((GEMM_MC + GEMM_NC) * GEMM_KC);
+  
+  double meanSquareError;
+  int currentEpoch = 1;
+  do {
+    // Reset the mean square error
+    meanSquareError = 0.0;
+    
+    for (size_t start = 0; start < x.size(); start += batch) {
+      size_t rows = min(batch, x.size() - start);
+      for (size_t r = 0; r < rows; r++) {
+        copy(x[start + r].begin(), x[start + r].end(), batchInputs.begin() + r * inputs);
+      }
+      
+      // Forward propagate the batch: hidden = sigmoid(X W_ih + bias), and
+      // output = sigmoid(hidden W_ho + bias)
+      multiplyMatrices(false, false, rows, this->hiddenNodes, inputs, batchInputs.data(), inputs, this->inputToHiddenWeights.data(), this->hiddenStride, batchHidden.data(), this->hiddenStride, packed.data());
+      for (size_t r = 0; r < rows; r++) {
+        double *hidden = batchHidden.data() + r * this->hiddenStride;
+        for (int hid = 0; hid < this->hiddenNodes; hid++) {
+          hidden[hid] = sigmoid(hidden[hid] + this->hiddenLayerBias[hid]);
+        }
+      }
+      multiplyMatrices(false, false, rows, this->outputNodes, this->hiddenNodes, batchHidden.data(), this->hiddenStride, this->hiddenToOutputWeights.data(), this->outputStride, batchOutput.data(), this->outputStride, packed.data());
+      for (size_t r = 0; r < rows; r++) {
+        double *output = batchOutput.data() + r * this->outputStride;
+        double *delta = outputDeltas.data() + r * this->outputStride;
+        double errorSquared = 0.0;
+        for (int out = 0; out < this->outputNodes; out++) {
+          output[out] = sigmoid(output[out] + this->outputLayerBias[out]);
+          
+          // Back-propagation- the "correct node" representing our class
+          // wants to be 1, and the others 0
+          double error = ((out == y[start + r]) ? 1 : 0) - output[out];
+          delta[out] = error * derSigmoid(output[out]);
+          errorSquared += pow(error, 2);
+        }
+        meanSquareError += errorSquared / (this->outputNodes + 1);
+      }
+      
+      // Find the deltas of the hidden layer- the output deltas times W_ho^T,
+      // times the derivative per the chain rule
+      multiplyMatrices(false, true, rows, this->hiddenNodes, this->outputNodes, outputDeltas.data(), this->outputStride, this->hiddenToOutputWeights.data(), this->outputStride, hiddenDeltas.data(), this->hiddenStride, packed.data());
+      for (size_t r = 0; r < rows; r++) {
+        const double *hidden = batchHidden.data() + r * this->hiddenStride;
+        double *delta = hiddenDeltas.data() + r * this->hiddenStride;
+        for (int hid = 0; hid < this->hiddenNodes; hid++) {
+          delta[hid] *= derSigmoid(hidden[hid]);
+        }
+      }
+      
+      // The gradients summed over the batch: X^T hidden deltas and
+      // hidden^T output deltas
+      multiplyMatrices(true, false, inputs, this->hiddenNodes, rows, batchInputs.data(), inputs, hiddenDeltas.data(), this->hiddenStride, inputToHiddenGradient.data(), this->hiddenStride, packed.data());
+      multiplyMatrices(true, false, this->hiddenNodes, this->outputNodes, rows, batchHidden.data(), this->hiddenStride, outputDeltas.data(), this->outputStride, hiddenToOutputGradient.data(), this->outputStride, packed.data());
+      
+      // Weight update step, w/ momentum (but not for the biases)
+      for (size_t inp = 0; inp < inputs; inp++) {
+        double *weights = this->inputToHiddenWeights.data() + inp * this->hiddenStride;
+        double *velocity = this->inputToHiddenVelocity.data() + inp * this->hiddenStride;
+        const double *gradient = inputToHiddenGradient.data() + inp * this->hiddenStride;
+        for (int hid = 0; hid < this->hiddenNodes; hid++) {
+          velocity[hid] = this->momentum * velocity[hid] + this->learningRate * gradient[hid];
+          weights[hid] += velocity[hid];
+        }
+      }
+      for (int hid = 0; hid < this->hiddenNodes; hid++) {
+        double *weights = this->hiddenToOutputWeights.data() + hid * this->outputStride;
+        double *velocity = this->hiddenToOutputVelocity.data() + hid * this->outputStride;
+        const double *gradient = hiddenToOutputGradient.data() + hid * this->outputStride;
+        for (int out = 0; out < this->outputNodes; out++) {
+          velocity[out] = this->momentum * velocity[out] + this->learningRate * gradient[out];
+          weights[out] += velocity[out];
+        }
+      }
+      for (size_t r = 0; r < rows; r++) {
+        const double *delta = hiddenDeltas.data() + r * this->hiddenStride;
+        for (int hid = 0; hid < this->hiddenNodes; hid++) {
+          this->hiddenLayerBias[hid] += this->learningRate * delta[hid];
+        }
+        delta = outputDeltas.data() + r * this->outputStride;
+        for (int out = 0; out < this->outputNodes; out++) {
+          this->outputLayerBias[out] += this->learningRate * delta[out];
+        }
+      }
+    }
+    cout << "Epoch " << currentEpoch << ": MSE = " << meanSquareError << endl;
+    currentEpoch++; // increment epoch
+  } while (meanSquareError >= (this->leastMeanSquareError + 0.0001));
+}
+
+void SHLMLP::setBatchSize(int batchSize) {
+  assert(batchSize > 0);
+  this->batchSize = batchSize;
 }
 
 int SHLMLP::test(vector<int> x) {
-  this->inputNodeValues = x;
+  this->setInputs(x);
   this->updateNodeValues();
   
   double maxValue = -1;
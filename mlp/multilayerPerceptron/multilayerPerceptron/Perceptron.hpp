@@ -9,6 +9,7 @@
 #ifndef Perceptron_hpp
 #define Perceptron_hpp
 
+#include "AlignedAllocator.hpp"
 #include <stdio.h>
 #include <vector>
 #include <random>
@@ -18,16 +19,28 @@ using namespace std;
 // A single hidden layer multilayer perceptron
 class SHLMLP {
 private:
-  // The current input node values- used for propagation
-  vector<int> inputNodeValues;
+  // The current input nodes w/ a nonzero value (most binarized pixels are 0)-
+  // used for propagation
+  vector<int> activeInputs;
+  // The value of each of `activeInputs`
+  vector<int> activeInputValues;
   // The current hidden node values
   vector<double> hiddenNodeValues;
   // The current output node values
   vector<double> outputNodeValues;
-  // 2D vector of weights between each node in the input layer to the hidden layer
-  vector<vector<double>> inputToHiddenWeights;
-  // 2D vector of weights between each node in the hidden layer to the output layer
-  vector<vector<double>> hiddenToOutputWeights;
+  // The weights between each node in the input layer to the hidden layer, one
+  // aligned row of `hiddenStride` per input node (weight [inp][hid] is at
+  // inp * hiddenStride + hid)
+  vector<double, AlignedAllocator<double>> inputToHiddenWeights;
+  // The weights between each node in the hidden layer to the output layer, one
+  // aligned row of `outputStride` per hidden node
+  vector<double, AlignedAllocator<double>> hiddenToOutputWeights;
+  // The last change of each input layer -> hidden layer weight (the momentum
+  // velocity), laid out like `inputToHiddenWeights`
+  vector<double, AlignedAllocator<double>> inputToHiddenVelocity;
+  // The last change of each hidden layer -> output layer weight, laid out
+  // like `hiddenToOutputWeights`
+  vector<double, AlignedAllocator<double>> hiddenToOutputVelocity;
   // The bias vector for the hidden layer
   vector<double> hiddenLayerBias;
   // The bias vector for the output layer
@@ -36,10 +49,43 @@ private:
   int inputNodes;   // the number of input nodes
   int outputNodes;  // the number of output nodes
   int hiddenNodes;  // the number of hidden nodes
+  size_t hiddenStride; // the padded length of a row of `inputToHiddenWeights`
+  size_t outputStride; // the padded length of a row of `hiddenToOutputWeights`
   
   double learningRate; // the learning rate (gamma)
   double leastMeanSquareError; // the stopping condition- when > MSE
   double momentum; // the gradient descent momentum term
+  int batchSize; // the # of samples per weight update (1 = after every sample)
+  
+  /**
+   Sets the active input nodes to the nonzero values of `x`.
+   
+   @param x the features
+   */
+  void setInputs(const vector<int> &x);
+  
+  /**
+   Applies `steps` weight updates w/o a gradient to the input layer -> hidden
+   layer weights of input node `inp`, i.e. the updates of `steps` samples in
+   which it was 0. Only the momentum moves those weights, and it decays
+   geometrically, so this costs one pass over the row however many steps
+   were skipped.
+   
+   @param inp   the input node
+   @param steps the number of skipped updates
+   */
+  void catchUpInputWeights(int inp, size_t steps);
+  
+  /**
+   Trains the network on mini-batches of `batchSize` samples until the MSE
+   stopping condition is met. The forward and backward passes of a batch
+   are cache-blocked matrix multiplications over buffers allocated once, and
+   the weights are updated once per batch w/ the summed gradient.
+   
+   @param x the training features
+   @param y the labels- should contain values from [0, outputNodes)
+   */
+  void trainMiniBatches(const vector<vector<int>> &x, const vector<int> &y);
   
 public:
   /**
@@ -55,7 +101,10 @@ public:
   SHLMLP(int inputNodes, int outputNodes, int hiddenNodes, double learningRate, double momentum, double leastMeanSquareError);
   
   /**
-   Updates the node values through propagation. 
+   Updates the node values through propagation. Each layer is the sum of
+   the previous layer's rows of weights, scaled by its node values, so every
+   weight is read w/ unit stride. Only the active input nodes' rows are
+   added, so the hidden layer costs O(active inputs * hidden nodes).
    */
   void updateNodeValues();
   
@@ -67,6 +116,17 @@ public:
    */
   void train(vector<vector<int>> x, vector<int> y);
   
+  /**
+   Sets the number of samples `train` propagates together before each weight
+   update. W/ more than 1, every layer is computed for the whole batch as
+   one matrix multiplication, which reuses each weight across the batch. The
+   update is the sum of the samples' gradients, so the learning rate keeps
+   its per-sample meaning.
+   
+   @param batchSize the batch size (1 by default, which updates after every sample)
+   */
+  void setBatchSize(int batchSize);
+  
   /**
    Predicts the class for features 'x'.
 
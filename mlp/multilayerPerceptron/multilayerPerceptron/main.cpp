@@ -88,11 +88,16 @@ int main(int argc, const char * argv[]) {
   double learningRate = 0.05;                   // The learning rate 0.04
   double momentum = 0.4;                        // The momentum term for gradient descent 0.4
   double leastMeanSquareError = 15;             // The stopping condition
+  int batchSize = (argc > 4) ? atoi(argv[4]) : 1; // The samples per weight update
   
   // Create and train the model
   SHLMLP model = SHLMLP(instanceCount, classes, hiddenNodeCount, learningRate, momentum, leastMeanSquareError);
+  model.setBatchSize(batchSize);
   cout << "Training single hidden layer MLP w/ " << hiddenNodeCount << " hidden nodes." << endl;
   cout << "Stopping when MSE falls < " << leastMeanSquareError << endl;
+  if (batchSize > 1) {
+    cout << "Mini-batches of " << batchSize << " samples" << endl;
+  }
   model.train(features, labels);
   cout << "Training Complete!" << endl << endl;
   
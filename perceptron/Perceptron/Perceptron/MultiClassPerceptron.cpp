@@ -0,0 +1,196 @@
+//
+//  MultiClassPerceptron.cpp
+//  Perceptron
+//
+//  Created by Brian Desnoyers on 2/23/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "MultiClassPerceptron.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <assert.h>
+
+/**
+ Returns the sorted distinct values of `y`.
+ */
+vector<int> distinctLabels(const vector<int> &y) {
+  vector<int> labels = y;
+  sort(labels.begin(), labels.end());
+  labels.erase(unique(labels.begin(), labels.end()), labels.end());
+  return labels;
+}
+
+/**
+ Relabels `y` as +1 for `positive` and -1 for everything else.
+ */
+vector<int> oneVsRestLabels(const vector<int> &y, int positive) {
+  vector<int> binary(y.size());
+  for (int i = 0; i < y.size(); i++) {
+    binary[i] = (y[i] == positive) ? 1 : -1;
+  }
+  return binary;
+}
+
+/**
+ Returns the index of the largest value in `v`.
+ */
+int argmax(const double *v, size_t n) {
+  int maxIndex = 0;
+  for (int i = 1; i < n; i++) {
+    if (v[i] > v[maxIndex]) {
+      maxIndex = i;
+    }
+  }
+  return maxIndex;
+}
+
+MultiClassPerceptron::MultiClassPerceptron(int maxIterations, unsigned threads) {
+  this->maxIterations = maxIterations;
+  this->threads = threads;
+}
+
+void MultiClassPerceptron::train(const vector<vector<double>> &x, const vector<int> &y) {
+  assert(x.size() == y.size());
+  this->classes = distinctLabels(y);
+  size_t classCount = this->classes.size();
+  size_t features = x[0].size();
+  this->weights.assign(features * classCount, 0.0);
+  this->biases.assign(classCount, 0.0);
+  
+  // Each task trains one model and writes only its own column of the weights
+  ThreadPool pool(this->threads);
+  for (int c = 0; c < classCount; c++) {
+    pool.enqueue([this, c, classCount, features, &x, &y]() {
+      Perceptron model;
+      model.setVerbose(false);
+      model.setMaxIterations(this->maxIterations);
+      model.train(x, oneVsRestLabels(y, this->classes[c]));
+      
+      vector<double> w = model.getWeights();
+      for (int i = 0; i < features; i++) {
+        this->weights[i * classCount + c] = w[i];
+      }
+      this->biases[c] = model.getBias();
+    });
+  }
+  pool.wait();
+}
+
+vector<double> MultiClassPerceptron::scores(const vector<double> &x) {
+  size_t classCount = this->classes.size();
+  vector<double> result = this->biases;
+  const double *w = this->weights.data();
+  for (int i = 0; i < x.size(); i++) {
+    if (x[i] == 0) {
+      continue;
+    }
+    const double *row = w + i * classCount;
+    for (int c = 0; c < classCount; c++) {
+      result[c] += x[i] * row[c];
+    }
+  }
+  return result;
+}
+
+int MultiClassPerceptron::predict(const vector<double> &x) {
+  vector<double> result = this->scores(x);
+  return this->classes[argmax(result.data(), result.size())];
+}
+
+void MultiClassPerceptron::predictBatch(const double *x, size_t rows, int *labels) {
+  size_t classCount = this->classes.size();
+  size_t features = this->weights.size() / classCount;
+  parallelRows(rows, this->threads, [&](size_t begin, size_t end) {
+    vector<double> result(classCount);
+    for (size_t r = begin; r < end; r++) {
+      const double *sample = x + r * features;
+      copy(this->biases.begin(), this->biases.end(), result.begin());
+      for (int i = 0; i < features; i++) {
+        if (sample[i] == 0) {
+          continue;
+        }
+        const double *row = this->weights.data() + i * classCount;
+        for (int c = 0; c < classCount; c++) {
+          result[c] += sample[i] * row[c];
+        }
+      }
+      labels[r] = this->classes[argmax(result.data(), classCount)];
+    }
+  });
+}
+
+vector<int> MultiClassPerceptron::getClasses() {
+  return this->classes;
+}
+
+
+MultiClassDualPerceptron::MultiClassDualPerceptron(function<double(const vector<double> &, const vector<double> &)> kernel, int maxIterations, unsigned threads) {
+  this->kernel = kernel;
+  this->maxIterations = maxIterations;
+  this->threads = threads;
+}
+
+void MultiClassDualPerceptron::train(const vector<vector<double>> &x, const vector<int> &y) {
+  assert(x.size() == y.size());
+  this->classes = distinctLabels(y);
+  size_t classCount = this->classes.size();
+  size_t samples = x.size();
+  
+  // One kernel matrix for all of the models
+  vector<double> gram = gramMatrix(x, this->kernel, this->threads);
+  
+  vector<vector<double>> counts(classCount);
+  this->biases.assign(classCount, 0.0);
+  ThreadPool pool(this->threads);
+  for (int c = 0; c < classCount; c++) {
+    pool.enqueue([this, c, &x, &y, &gram, &counts]() {
+      DualPerceptron model(this->kernel);
+      model.setVerbose(false);
+      model.setMaxIterations(this->maxIterations);
+      model.train(x, oneVsRestLabels(y, this->classes[c]), gram.data());
+      counts[c] = model.getCounts();
+      this->biases[c] = model.getBias();
+    });
+  }
+  pool.wait();
+  
+  // Keep only the samples that contribute to at least one model
+  this->supportVectors.clear();
+  this->coefficients.clear();
+  for (int j = 0; j < samples; j++) {
+    bool used = false;
+    for (int c = 0; c < classCount; c++) {
+      used = used || counts[c][j] != 0;
+    }
+    if (!used) {
+      continue;
+    }
+    this->supportVectors.push_back(x[j]);
+    for (int c = 0; c < classCount; c++) {
+      this->coefficients.push_back(counts[c][j] * ((y[j] == this->classes[c]) ? 1 : -1));
+    }
+  }
+}
+
+vector<double> MultiClassDualPerceptron::scores(const vector<double> &x) {
+  size_t classCount = this->classes.size();
+  vector<double> result = this->biases;
+  for (int j = 0; j < this->supportVectors.size(); j++) {
+    double k = this->kernel(this->supportVectors[j], x);
+    const double *coef = this->coefficients.data() + j * classCount;
+    for (int c = 0; c < classCount; c++) {
+      result[c] += coef[c] * k;
+    }
+  }
+  return result;
+}
+
+int MultiClassDualPerceptron::predict(const vector<double> &x) {
+  vector<double> result = this->scores(x);
+  return this->classes[argmax(result.data(), result.size())];
+}
+
+vector<int> MultiClassDualPerceptron::getClasses() {
+  return this->classes;
+}
@@ -0,0 +1,162 @@
+//
+//  MultiClassPerceptron.hpp
+//  Perceptron
+//
+//  Created by Brian Desnoyers on 2/23/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef MultiClassPerceptron_hpp
+#define MultiClassPerceptron_hpp
+
+#include "Perceptron.hpp"
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ A one-vs-rest multiclass classifier built from primal perceptrons.
+ One binary perceptron is trained per class, all at once on a thread pool.
+ */
+class MultiClassPerceptron {
+private:
+  // the distinct labels seen in training, one binary model each
+  vector<int> classes;
+  // the weights of every model, a (features x classes) row-major matrix so
+  // all of the class scores are accumulated in one pass over a sample
+  vector<double> weights;
+  // the bias of each model
+  vector<double> biases;
+  // the max # of passes each binary model makes over the training set
+  int maxIterations;
+  // the number of threads to train and score with (0 = one per core)
+  unsigned threads;
+  
+public:
+  /**
+   Initializes a one-vs-rest classifier.
+   
+   @param maxIterations the max # of passes for each binary model, 0 = no cap
+   @param threads       the number of threads to use (0 = one per core)
+   */
+  MultiClassPerceptron(int maxIterations, unsigned threads = 0);
+  
+  /**
+   Trains one binary perceptron per distinct label in `y`. The models all read
+   the same copy of `x`.
+   
+   @param x the features to train
+   @param y the corresponding labels- any ints
+   */
+  void train(const vector<vector<double>> &x, const vector<int> &y);
+  
+  /**
+   Returns the margin of every binary model for `x`, in the order of
+   `getClasses()`.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the score of each class
+   */
+  vector<double> scores(const vector<double> &x);
+  
+  /**
+   Predicts the class of `x` as the class w/ the largest score.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted label
+   */
+  int predict(const vector<double> &x);
+  
+  /**
+   Predicts the classes of `rows` feature vectors stored contiguously in
+   row-major order in `x`, writing them to `labels`.
+   Note: This should be called only after training a model.
+   
+   @param x      the row-major feature matrix
+   @param rows   the number of rows in `x`
+   @param labels the output buffer, must hold `rows` values
+   */
+  void predictBatch(const double *x, size_t rows, int *labels);
+  
+  /**
+   Returns the labels seen in training, in the order models are scored.
+   
+   @return the labels
+   */
+  vector<int> getClasses();
+};
+
+/**
+ A one-vs-rest multiclass classifier built from dual-form (kernelized)
+ perceptrons. The binary models are trained at once on a thread pool and share
+ a single kernel matrix.
+ */
+class MultiClassDualPerceptron {
+private:
+  // the kernel function
+  function<double(const vector<double> &, const vector<double> &)> kernel;
+  // the distinct labels seen in training, one binary model each
+  vector<int> classes;
+  // the training samples that any of the models made a mistake on
+  vector<vector<double>> supportVectors;
+  // m_j * y_j of each support vector in each model, a
+  // (supportVectors x classes) row-major matrix
+  vector<double> coefficients;
+  // the bias of each model
+  vector<double> biases;
+  // the max # of passes each binary model makes over the training set
+  int maxIterations;
+  // the number of threads to train with (0 = one per core)
+  unsigned threads;
+  
+public:
+  /**
+   Initializes a one-vs-rest kernelized classifier.
+   
+   @param kernel        the kernel
+   @param maxIterations the max # of passes for each binary model, 0 = no cap
+   @param threads       the number of threads to use (0 = one per core)
+   */
+  MultiClassDualPerceptron(function<double(const vector<double> &, const vector<double> &)> kernel, int maxIterations, unsigned threads = 0);
+  
+  /**
+   Trains one binary dual perceptron per distinct label in `y`. The kernel
+   matrix of `x` is calculated once and shared by every model.
+   
+   @param x the features to train
+   @param y the corresponding labels- any ints
+   */
+  void train(const vector<vector<double>> &x, const vector<int> &y);
+  
+  /**
+   Returns the margin of every binary model for `x`, in the order of
+   `getClasses()`. Each kernel value is calculated once and used by all of
+   the models.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the score of each class
+   */
+  vector<double> scores(const vector<double> &x);
+  
+  /**
+   Predicts the class of `x` as the class w/ the largest score.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted label
+   */
+  int predict(const vector<double> &x);
+  
+  /**
+   Returns the labels seen in training, in the order models are scored.
+   
+   @return the labels
+   */
+  vector<int> getClasses();
+};
+
+#endif /* MultiClassPerceptron_hpp */
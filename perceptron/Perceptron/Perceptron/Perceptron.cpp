@@ -7,22 +7,311 @@
 //
 
 #include "Perceptron.hpp"
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
 #include <math.h>
+#include <thread>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-double dotProduct(vector<double> v1, vector<double> v2) {
-  assert(v1.size() == v2.size());
-  
+double simdDot(const double *a, const double *b, size_t n) {
+  size_t i = 0;
   double result = 0;
-  for (int i = 0; i < v1.size(); i++) {
-    result += (v1[i] * v2[i]);
+#if defined(__AVX__)
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1];
+#endif
+  for (; i < n; i++) {
+    result += a[i] * b[i];
   }
-  
   return result;
 }
 
-vector<double> subtract(vector<double> v1, vector<double> v2) {
+/**
+ Computes the dot products of four consecutive rows of a row-major matrix with
+ `w`, so each element of `w` is loaded once per four rows.
+ 
+ @param rows   the first of the four rows
+ @param stride the distance between rows (the column count)
+ @param w      the vector to multiply against
+ @param n      the length of `w`
+ @param out    the four resulting dot products
+ */
+void simdDot4(const double *rows, size_t stride, const double *w, size_t n, double out[4]) {
+  const double *r0 = rows;
+  const double *r1 = rows + stride;
+  const double *r2 = rows + 2 * stride;
+  const double *r3 = rows + 3 * stride;
+  size_t i = 0;
+  out[0] = out[1] = out[2] = out[3] = 0;
+#if defined(__AVX__)
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m256d wv = _mm256_loadu_pd(w + i);
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(r0 + i), wv));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(r1 + i), wv));
+    acc2 = _mm256_add_pd(acc2, _mm256_mul_pd(_mm256_loadu_pd(r2 + i), wv));
+    acc3 = _mm256_add_pd(acc3, _mm256_mul_pd(_mm256_loadu_pd(r3 + i), wv));
+  }
+  double lanes[4];
+  __m256d accs[4] = {acc0, acc1, acc2, acc3};
+  for (int r = 0; r < 4; r++) {
+    _mm256_storeu_pd(lanes, accs[r]);
+    out[r] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#elif defined(__SSE2__)
+  __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+  __m128d acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+  for (; i + 2 <= n; i += 2) {
+    __m128d wv = _mm_loadu_pd(w + i);
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(r0 + i), wv));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(r1 + i), wv));
+    acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(r2 + i), wv));
+    acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(r3 + i), wv));
+  }
+  double lanes[2];
+  __m128d accs[4] = {acc0, acc1, acc2, acc3};
+  for (int r = 0; r < 4; r++) {
+    _mm_storeu_pd(lanes, accs[r]);
+    out[r] = lanes[0] + lanes[1];
+  }
+#endif
+  for (; i < n; i++) {
+    out[0] += r0[i] * w[i];
+    out[1] += r1[i] * w[i];
+    out[2] += r2[i] * w[i];
+    out[3] += r3[i] * w[i];
+  }
+}
+
+void parallelRows(size_t rows, unsigned threads, const function<void(size_t, size_t)> &work, size_t minRowsPerThread) {
+  if (threads == 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  // Don't spin up threads that would have almost nothing to do
+  size_t maxUseful = max((size_t)1, rows / minRowsPerThread);
+  if (threads > maxUseful) {
+    threads = (unsigned)maxUseful;
+  }
+  
+  size_t chunk = (rows + threads - 1) / threads;
+  vector<thread> workers;
+  for (unsigned t = 0; t + 1 < threads; t++) {
+    size_t begin = t * chunk;
+    size_t end = min(rows, begin + chunk);
+    workers.push_back(thread(work, begin, end));
+  }
+  work(min(rows, (threads - 1) * chunk), rows);
+  for (int t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+/**
+ Computes the margins w . x + b for rows [begin, end) of the row-major matrix
+ `x`, handing each one to `store(row, margin)`.
+ */
+template <typename Store>
+void scoreRows(const double *x, size_t cols, const double *w, double b, size_t begin, size_t end, Store store) {
+  size_t i = begin;
+  double dots[4];
+  for (; i + 4 <= end; i += 4) {
+    simdDot4(x + i * cols, cols, w, cols, dots);
+    for (int r = 0; r < 4; r++) {
+      store(i + r, dots[r] + b);
+    }
+  }
+  for (; i < end; i++) {
+    store(i, simdDot(x + i * cols, w, cols) + b);
+  }
+}
+
+// The register tile of `blockedDots`: GEMM_MR rows by GEMM_NR columns
+const int GEMM_MR = 4;
+const int GEMM_NR = 8;
+
+// The cache blocks of `blockedDots`: GEMM_KC columns of GEMM_MC rows stay in
+// L1/L2 while they're multiplied by the same columns of GEMM_NC other rows
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 64;
+const size_t GEMM_NC = 256;
+
+// The # of rows `DualPerceptron::kernelMargins` multiplies by the support
+// vectors at once
+const size_t KERNEL_BLOCK_ROWS = 256;
+
+/**
+ Copies columns [k0, k0 + kc) of `count` rows, `stride` apart, into `packed`
+ in slabs of `tile` rows. Within a slab the values are column-major, so the
+ micro-kernel reads both operands w/ unit stride. The last slab is padded
+ w/ 0 rows.
+ */
+void packRows(const double *rows, size_t stride, size_t count, size_t k0, size_t kc, int tile, double *packed) {
+  for (size_t s = 0; s < count; s += tile) {
+    double *slab = packed + s * kc;
+    for (int t = 0; t < tile; t++) {
+      if (s + t < count) {
+        const double *row = rows + (s + t) * stride + k0;
+        for (size_t k = 0; k < kc; k++) {
+          slab[k * tile + t] = row[k];
+        }
+      } else {
+        for (size_t k = 0; k < kc; k++) {
+          slab[k * tile + t] = 0;
+        }
+      }
+    }
+  }
+}
+
+/**
+ Multiplies a packed slab of GEMM_MR rows by a packed slab of GEMM_NR rows
+ over `kc` columns, and adds the top left `mr` x `nr` of the product to `out`,
+ whose rows are `outStride` apart.
+ */
+void multiplyTile(size_t kc, const double *a, const double *b, double *out, size_t outStride, int mr, int nr) {
+  double tile[GEMM_MR * GEMM_NR];
+#if defined(__AVX__)
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  for (size_t k = 0; k < kc; k++) {
+    __m256d b0 = _mm256_loadu_pd(b + k * GEMM_NR);
+    __m256d b1 = _mm256_loadu_pd(b + k * GEMM_NR + 4);
+    __m256d a0 = _mm256_broadcast_sd(a + k * GEMM_MR);
+    c00 = _mm256_add_pd(c00, _mm256_mul_pd(a0, b0));
+    c01 = _mm256_add_pd(c01, _mm256_mul_pd(a0, b1));
+    __m256d a1 = _mm256_broadcast_sd(a + k * GEMM_MR + 1);
+    c10 = _mm256_add_pd(c10, _mm256_mul_pd(a1, b0));
+    c11 = _mm256_add_pd(c11, _mm256_mul_pd(a1, b1));
+    __m256d a2 = _mm256_broadcast_sd(a + k * GEMM_MR + 2);
+    c20 = _mm256_add_pd(c20, _mm256_mul_pd(a2, b0));
+    c21 = _mm256_add_pd(c21, _mm256_mul_pd(a2, b1));
+    __m256d a3 = _mm256_broadcast_sd(a + k * GEMM_MR + 3);
+    c30 = _mm256_add_pd(c30, _mm256_mul_pd(a3, b0));
+    c31 = _mm256_add_pd(c31, _mm256_mul_pd(a3, b1));
+  }
+  _mm256_storeu_pd(tile, c00);
+  _mm256_storeu_pd(tile + 4, c01);
+  _mm256_storeu_pd(tile + 8, c10);
+  _mm256_storeu_pd(tile + 12, c11);
+  _mm256_storeu_pd(tile + 16, c20);
+  _mm256_storeu_pd(tile + 20, c21);
+  _mm256_storeu_pd(tile + 24, c30);
+  _mm256_storeu_pd(tile + 28, c31);
+#elif defined(__SSE2__)
+  // One row of the tile at a time, in 4 registers
+  for (int r = 0; r < GEMM_MR; r++) {
+    __m128d c0 = _mm_setzero_pd();
+    __m128d c1 = _mm_setzero_pd();
+    __m128d c2 = _mm_setzero_pd();
+    __m128d c3 = _mm_setzero_pd();
+    for (size_t k = 0; k < kc; k++) {
+      __m128d ar = _mm_set1_pd(a[k * GEMM_MR + r]);
+      const double *bk = b + k * GEMM_NR;
+      c0 = _mm_add_pd(c0, _mm_mul_pd(ar, _mm_loadu_pd(bk)));
+      c1 = _mm_add_pd(c1, _mm_mul_pd(ar, _mm_loadu_pd(bk + 2)));
+      c2 = _mm_add_pd(c2, _mm_mul_pd(ar, _mm_loadu_pd(bk + 4)));
+      c3 = _mm_add_pd(c3, _mm_mul_pd(ar, _mm_loadu_pd(bk + 6)));
+    }
+    _mm_storeu_pd(tile + r * GEMM_NR, c0);
+    _mm_storeu_pd(tile + r * GEMM_NR + 2, c1);
+    _mm_storeu_pd(tile + r * GEMM_NR + 4, c2);
+    _mm_storeu_pd(tile + r * GEMM_NR + 6, c3);
+  }
+#else
+  fill(tile, tile + GEMM_MR * GEMM_NR, 0.0);
+  for (size_t k = 0; k < kc; k++) {
+    for (int r = 0; r < GEMM_MR; r++) {
+      for (int c = 0; c < GEMM_NR; c++) {
+        tile[r * GEMM_NR + c] += a[k * GEMM_MR + r] * b[k * GEMM_NR + c];
+      }
+    }
+  }
+#endif
+  for (int r = 0; r < mr; r++) {
+    for (int c = 0; c < nr; c++) {
+      out[r * outStride + c] += tile[r * GEMM_NR + c];
+    }
+  }
+}
+
+/**
+ Finds the dot product of every one of `rows` rows of the row-major matrix `a`
+ w/ every one of `cols` rows of the row-major matrix `b`, both w/ `depth`
+ columns, as a cache-blocked matrix multiply (A B^T). Blocks of both are
+ packed so they're read w/ unit stride, and a GEMM_MR x GEMM_NR tile of the
+ product is built in registers.
+ 
+ @param a     the 1st matrix
+ @param rows  the number of rows in `a`
+ @param b     the 2nd matrix
+ @param cols  the number of rows in `b`
+ @param depth the number of columns in both
+ @param out   the rows x cols dot products, row-major
+ */
+void blockedDots(const double *a, size_t rows, const double *b, size_t cols, size_t depth, double *out) {
+  fill(out, out + rows * cols, 0.0);
+  vector<double> packedA(GEMM_MC * GEMM_KC);
+  vector<double> packedB(GEMM_NC * GEMM_KC);
+  for (size_t jc = 0; jc < cols; jc += GEMM_NC) {
+    size_t nc = min(GEMM_NC, cols - jc);
+    for (size_t pc = 0; pc < depth; pc += GEMM_KC) {
+      size_t kc = min(GEMM_KC, depth - pc);
+      packRows(b + jc * depth, depth, nc, pc, kc, GEMM_NR, packedB.data());
+      for (size_t ic = 0; ic < rows; ic += GEMM_MC) {
+        size_t mc = min(GEMM_MC, rows - ic);
+        packRows(a + ic * depth, depth, mc, pc, kc, GEMM_MR, packedA.data());
+        for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+          for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+            multiplyTile(kc, packedA.data() + ir * kc, packedB.data() + jr * kc, out + (ic + ir) * cols + jc + jr, cols, (int)min((size_t)GEMM_MR, mc - ir), (int)min((size_t)GEMM_NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ The built-in kernels, which all follow from u . v, |u|^2 and |v|^2.
+ */
+enum DotKernel {
+  // Any other kernel, which has to be called on the vectors themselves
+  OTHER_KERNEL,
+  DOT_PRODUCT_KERNEL,
+  POLYNOMIAL_DOT_KERNEL,
+  GAUSSIAN_DOT_KERNEL,
+  LAPLACIAN_DOT_KERNEL
+};
+
+double dotProduct(const vector<double> &v1, const vector<double> &v2) {
+  assert(v1.size() == v2.size());
+  
+  return simdDot(v1.data(), v2.data(), v1.size());
+}
+
+vector<double> subtract(const vector<double> &v1, const vector<double> &v2) {
   assert(v1.size() == v2.size());
   
   vector<double> result;
@@ -33,7 +322,7 @@ vector<double> subtract(vector<double> v1, vector<double> v2) {
   return result;
 }
 
-double magnitude(vector<double> v1) {
+double magnitude(const vector<double> &v1) {
   double result = 0;
   for (int i = 0; i < v1.size(); i++) {
     result += pow(v1[i], 2);
@@ -41,27 +330,65 @@ double magnitude(vector<double> v1) {
   return sqrt(result);
 }
 
-double polynomialKernel(vector<double> v1, vector<double> v2) {
+double polynomialKernel(const vector<double> &v1, const vector<double> &v2) {
   double p = 3;
   return pow((1 + dotProduct(v1, v2)), p);
 }
 
-double gaussianKernel(vector<double> v1, vector<double> v2) {
+double gaussianKernel(const vector<double> &v1, const vector<double> &v2) {
   double sigma = 1;
   return exp((-1 * pow(magnitude(subtract(v1, v2)), 2)) / (2 * pow(sigma, 2)));
 }
 
-double laplacianKernel(vector<double> v1, vector<double> v2) {
+double laplacianKernel(const vector<double> &v1, const vector<double> &v2) {
   double sigma = 1;
   return exp((-1 * magnitude(subtract(v1, v2))) / sigma);
 }
 
-void Perceptron::train(vector<vector<double>> x, vector<int> y) {
-  // Initialize weight and bias = 0
-  if (!this->w.empty()) {
-    this->w.erase(w.begin());
+/**
+ Returns which built-in kernel `kernel` holds, if any.
+ */
+DotKernel dotKernelOf(const function<double(const vector<double> &, const vector<double> &)> &kernel) {
+  typedef double (*KernelFunction)(const vector<double> &, const vector<double> &);
+  const KernelFunction *target = kernel.target<KernelFunction>();
+  if (target == NULL) {
+    return OTHER_KERNEL;
+  } else if (*target == dotProduct) {
+    return DOT_PRODUCT_KERNEL;
+  } else if (*target == polynomialKernel) {
+    return POLYNOMIAL_DOT_KERNEL;
+  } else if (*target == gaussianKernel) {
+    return GAUSSIAN_DOT_KERNEL;
+  } else if (*target == laplacianKernel) {
+    return LAPLACIAN_DOT_KERNEL;
   }
-  this->w.resize(x[0].size(), 0.0);
+  return OTHER_KERNEL;
+}
+
+/**
+ Returns a built-in kernel's value from u . v, |u|^2 and |v|^2, w/ the same
+ parameters as `polynomialKernel`, `gaussianKernel` and `laplacianKernel`.
+ */
+double kernelFromDot(DotKernel kernel, double dot, double normU, double normV) {
+  // |u - v|^2, which rounding could take just below 0
+  double squaredDistance = max(0.0, normU + normV - 2 * dot);
+  switch (kernel) {
+    case POLYNOMIAL_DOT_KERNEL: {
+      double base = 1 + dot;
+      return base * base * base;
+    }
+    case GAUSSIAN_DOT_KERNEL:
+      return exp(-squaredDistance / 2);
+    case LAPLACIAN_DOT_KERNEL:
+      return exp(-sqrt(squaredDistance));
+    default:
+      return dot;
+  }
+}
+
+void Perceptron::train(const vector<vector<double>> &x, const vector<int> &y) {
+  // Initialize weight and bias = 0
+  this->w.assign(x[0].size(), 0.0);
   this->b = 0;
   
   int mistakes;
@@ -80,8 +407,18 @@ void Perceptron::train(vector<vector<double>> x, vector<int> y) {
         b += y[i];
       }
     }
-    cout << "Iteration " << iterationsUntilConvergence << ": w/ " << mistakes << " mistakes" << endl;
-  } while (mistakes != 0);
+    if (this->verbose) {
+      cout << "Iteration " << iterationsUntilConvergence << ": w/ " << mistakes << " mistakes" << endl;
+    }
+  } while (mistakes != 0 && (this->maxIterations <= 0 || iterationsUntilConvergence < this->maxIterations));
+}
+
+void Perceptron::setMaxIterations(int maxIterations) {
+  this->maxIterations = maxIterations;
+}
+
+void Perceptron::setVerbose(bool verbose) {
+  this->verbose = verbose;
 }
 
 vector<double> Perceptron::getWeights() {
@@ -101,41 +438,61 @@ double Perceptron::getBias() {
   return this->b;
 }
 
+int Perceptron::predict(const vector<double> &x) {
+  return (dotProduct(this->w, x) + this->b > 0) ? 1 : -1;
+}
+
+void Perceptron::predictBatch(const double *x, size_t rows, int *labels, unsigned threads) {
+  const double *w = this->w.data();
+  size_t cols = this->w.size();
+  double b = this->b;
+  parallelRows(rows, threads, [=](size_t begin, size_t end) {
+    scoreRows(x, cols, w, b, begin, end, [=](size_t row, double margin) {
+      labels[row] = (margin > 0) ? 1 : -1;
+    });
+  });
+}
 
-DualPerceptron::DualPerceptron(function<double(vector<double>, vector<double>)> kernel) {
+void Perceptron::predictBatch(const double *x, size_t rows, double *margins, unsigned threads) {
+  const double *w = this->w.data();
+  size_t cols = this->w.size();
+  double b = this->b;
+  parallelRows(rows, threads, [=](size_t begin, size_t end) {
+    scoreRows(x, cols, w, b, begin, end, [=](size_t row, double margin) {
+      margins[row] = margin;
+    });
+  });
+}
+
+
+DualPerceptron::DualPerceptron(function<double(const vector<double> &, const vector<double> &)> kernel) {
   this->kernel = kernel;
 }
 
-void DualPerceptron::train(vector<vector<double>> x, vector<int> y) {
+void DualPerceptron::train(const vector<vector<double>> &x, const vector<int> &y) {
+  // Calculate result of kernals to speed up computation later
+  vector<double> k = gramMatrix(x, this->kernel);
+  this->train(x, y, k.data());
+}
+
+void DualPerceptron::train(const vector<vector<double>> &x, const vector<int> &y, const double *gram) {
   // Initialize m, w, and b
-  if (!this->m.empty()) {
-    this->m.erase(m.begin());
-  }
-  this->m.resize(x.size(), 0.0);
-  if (!this->w.empty()) {
-    this->w.erase(w.begin());
-  }
-  this->w.resize(x[0].size(), 0.0);
+  size_t samples = x.size();
+  this->m.assign(samples, 0.0);
+  this->w.assign(x[0].size(), 0.0);
   this->b = 0;
   
-  // Calculate result of kernals to speed up computation later
-  double k[x.size()][x.size()];
-  for (int i = 0; i < x.size(); i++) {
-    for (int j = 0; j < x.size(); j++) {
-      k[i][j] = this->kernel(x[i], x[j]);
-    }
-  }
-  
   int mistakes;
   int iterationsUntilConvergence = 0;
   do {
     mistakes = 0;
     iterationsUntilConvergence++;
-    for (int i = 0; i < x.size(); i++) {
-      // training sample i
+    for (int i = 0; i < samples; i++) {
+      // training sample i- the kernel matrix is symmetric, so read row i
+      const double *k = gram + i * samples;
       double yTest = 0;
-      for (int j = 0; j < x.size(); j++) {
-        yTest += (k[j][i] * this->m[j] * y[j]);
+      for (int j = 0; j < samples; j++) {
+        yTest += (k[j] * this->m[j] * y[j]);
       }
       yTest += this->b;
       // Check if prediction (sign(yTest)) matches label
@@ -145,14 +502,120 @@ void DualPerceptron::train(vector<vector<double>> x, vector<int> y) {
         b += y[i];
       }
     }
-    cout << "Iteration " << iterationsUntilConvergence << ": w/ " << mistakes << " mistakes" << endl;
-  } while (mistakes != 0);
+    if (this->verbose) {
+      cout << "Iteration " << iterationsUntilConvergence << ": w/ " << mistakes << " mistakes" << endl;
+    }
+  } while (mistakes != 0 && (this->maxIterations <= 0 || iterationsUntilConvergence < this->maxIterations));
   
   // Calculate w
   for (int i = 0; i < x[0].size(); i++) {
     // Calculate w_i
-    for (int j = 0; j < x.size(); j++) {
+    for (int j = 0; j < samples; j++) {
       w[i] += m[j] * y[j] * x[j][i];
     }
   }
+  
+  // Keep the samples w/ m_j > 0 for prediction w/ the kernel
+  size_t features = x[0].size();
+  this->supportVectors.clear();
+  this->coefficients.clear();
+  this->svSquaredNorms.clear();
+  for (int j = 0; j < samples; j++) {
+    if (this->m[j] == 0) {
+      continue;
+    }
+    this->supportVectors.insert(this->supportVectors.end(), x[j].begin(), x[j].end());
+    this->coefficients.push_back(this->m[j] * y[j]);
+    this->svSquaredNorms.push_back(simdDot(x[j].data(), x[j].data(), features));
+  }
+}
+
+vector<double> DualPerceptron::getCounts() {
+  return this->m;
+}
+
+void DualPerceptron::kernelMargins(const double *x, size_t begin, size_t end, double *margins) {
+  size_t svCount = this->coefficients.size();
+  size_t features = this->w.size();
+  DotKernel kind = dotKernelOf(this->kernel);
+  if (kind == OTHER_KERNEL) {
+    vector<double> query(features);
+    vector<double> sv(features);
+    for (size_t r = begin; r < end; r++) {
+      copy(x + r * features, x + (r + 1) * features, query.begin());
+      double margin = this->b;
+      for (size_t j = 0; j < svCount; j++) {
+        const double *row = this->supportVectors.data() + j * features;
+        copy(row, row + features, sv.begin());
+        margin += this->coefficients[j] * this->kernel(sv, query);
+      }
+      margins[r] = margin;
+    }
+    return;
+  }
+  
+  vector<double> dots(KERNEL_BLOCK_ROWS * svCount);
+  for (size_t start = begin; start < end; start += KERNEL_BLOCK_ROWS) {
+    size_t count = min(KERNEL_BLOCK_ROWS, end - start);
+    blockedDots(x + start * features, count, this->supportVectors.data(), svCount, features, dots.data());
+    for (size_t r = 0; r < count; r++) {
+      const double *query = x + (start + r) * features;
+      double queryNorm = simdDot(query, query, features);
+      const double *row = dots.data() + r * svCount;
+      double margin = this->b;
+      for (size_t j = 0; j < svCount; j++) {
+        margin += this->coefficients[j] * kernelFromDot(kind, row[j], this->svSquaredNorms[j], queryNorm);
+      }
+      margins[start + r] = margin;
+    }
+  }
+}
+
+int DualPerceptron::predict(const vector<double> &x) {
+  assert(x.size() == this->w.size());
+  double margin;
+  this->kernelMargins(x.data(), 0, 1, &margin);
+  return (margin > 0) ? 1 : -1;
+}
+
+void DualPerceptron::predictBatch(const double *x, size_t rows, int *labels, unsigned threads) {
+  parallelRows(rows, threads, [=](size_t begin, size_t end) {
+    vector<double> margins(end - begin);
+    this->kernelMargins(x + begin * this->w.size(), 0, end - begin, margins.data());
+    for (size_t r = begin; r < end; r++) {
+      labels[r] = (margins[r - begin] > 0) ? 1 : -1;
+    }
+  }, KERNEL_BLOCK_ROWS);
+}
+
+void DualPerceptron::predictBatch(const double *x, size_t rows, double *margins, unsigned threads) {
+  parallelRows(rows, threads, [=](size_t begin, size_t end) {
+    this->kernelMargins(x, begin, end, margins);
+  }, KERNEL_BLOCK_ROWS);
+}
+
+vector<double> gramMatrix(const vector<vector<double>> &x, function<double(const vector<double> &, const vector<double> &)> kernel, unsigned threads) {
+  size_t samples = x.size();
+  vector<double> k(samples * samples);
+  double *out = k.data();
+  // Only the upper triangle is calculated, then mirrored. Rows i and
+  // (samples - 1 - i) are handed out together so every chunk does equal work.
+  size_t pairs = (samples + 1) / 2;
+  parallelRows(pairs, threads, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      size_t rows[2] = {p, samples - 1 - p};
+      for (int r = 0; r < ((rows[0] == rows[1]) ? 1 : 2); r++) {
+        size_t i = rows[r];
+        for (size_t j = i; j < samples; j++) {
+          out[i * samples + j] = kernel(x[i], x[j]);
+        }
+      }
+    }
+  }, 8);
+  for (size_t i = 0; i < samples; i++) {
+    for (size_t j = 0; j < i; j++) {
+      out[i * samples + j] = out[j * samples + i];
+    }
+  }
+  return k;
 }
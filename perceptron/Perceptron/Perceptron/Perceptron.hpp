@@ -10,6 +10,7 @@
 #define Perceptron_hpp
 
 #include <functional>
+#include <stddef.h>
 #include <stdio.h>
 #include <vector>
 
@@ -22,7 +23,7 @@ using namespace std;
  @param v2 the 2nd vector
  @return the dot product between two equal lengthed vectors `v1` and `v2`
  */
-double dotProduct(vector<double> v1, vector<double> v2);
+double dotProduct(const vector<double> &v1, const vector<double> &v2);
 
 /**
  A polynomial kernel with p = 3.
@@ -31,7 +32,7 @@ double dotProduct(vector<double> v1, vector<double> v2);
  @param v2 the second vector
  @return the result of the kernel function
  */
-double polynomialKernel(vector<double> v1, vector<double> v2);
+double polynomialKernel(const vector<double> &v1, const vector<double> &v2);
 
 /**
  A gaussian kernel w/ sigma = 1.0 (lambda = 0.5).
@@ -40,7 +41,7 @@ double polynomialKernel(vector<double> v1, vector<double> v2);
  @param v2 the 2nd vector
  @return the result of the kernel function
  */
-double gaussianKernel(vector<double> v1, vector<double> v2);
+double gaussianKernel(const vector<double> &v1, const vector<double> &v2);
 
 /**
  A laplacian kernel w/ sigma = 1.0.
@@ -49,7 +50,32 @@ double gaussianKernel(vector<double> v1, vector<double> v2);
  @param v2 the 2nd vector
  @return the result of the kernel function
  */
-double laplacianKernel(vector<double> v1, vector<double> v2);
+double laplacianKernel(const vector<double> &v1, const vector<double> &v2);
+
+/**
+ Returns the dot product of two arrays of length `n`. Uses AVX or SSE2 when the
+ compiler targets them, with several accumulators to hide the add latency.
+ 
+ @param a the 1st array
+ @param b the 2nd array
+ @param n the length of both arrays
+ @return the dot product
+ */
+double simdDot(const double *a, const double *b, size_t n);
+
+// The fewest rows worth handing to a separate thread in `parallelRows`
+const size_t MIN_ROWS_PER_THREAD = 4096;
+
+/**
+ Splits `rows` rows into contiguous chunks and calls `work(begin, end)` on each
+ chunk from its own thread. The calling thread handles the last chunk.
+ 
+ @param rows    the number of rows to split
+ @param threads the requested thread count (0 = one per core)
+ @param work    the function to run on each chunk
+ @param minRowsPerThread the fewest rows worth handing to a separate thread
+ */
+void parallelRows(size_t rows, unsigned threads, const function<void(size_t, size_t)> &work, size_t minRowsPerThread = MIN_ROWS_PER_THREAD);
 
 /**
  A single-node perceptron class using the primal form.
@@ -60,15 +86,37 @@ protected:
   vector<double> w;
   // the bias
   double b;
+  // the max # of passes over the training set, 0 = until no mistakes are made
+  int maxIterations = 0;
+  // whether to print the mistake count of each pass
+  bool verbose = true;
   
 public:
+  virtual ~Perceptron() {}
+  
   /**
    Trains the perceptron with features 'x' and labels 'y'.
    
    @param x the features to train
    @param y the corresponding labels
    */
-  virtual void train(vector<vector<double>> x, vector<int> y);
+  virtual void train(const vector<vector<double>> &x, const vector<int> &y);
+  
+  /**
+   Caps the number of passes over the training set. Without a cap, training
+   only stops once the data is separated, which never happens for data that
+   isn't linearly (or kernel) separable.
+   
+   @param maxIterations the max # of passes, 0 = no cap
+   */
+  void setMaxIterations(int maxIterations);
+  
+  /**
+   Turns the per-pass training output on or off.
+   
+   @param verbose whether to print the mistake count of each pass
+   */
+  void setVerbose(bool verbose);
   
   /**
    Returns the weights after training. 
@@ -93,6 +141,41 @@ public:
    @return the bias after training
    */
   double getBias();
+  
+  /**
+   Predicts the class (+1 or -1) of a single feature vector `x`.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted class
+   */
+  virtual int predict(const vector<double> &x);
+  
+  /**
+   Scores `rows` feature vectors stored contiguously in row-major order in `x`
+   (each row has getWeights().size() columns) and writes the predicted classes
+   (+1 or -1) to `labels`. The rows are scored as a single vectorized
+   matrix-vector product, split across `threads` threads (0 = one per core).
+   Note: This should be called only after training a model.
+   
+   @param x       the row-major feature matrix
+   @param rows    the number of rows in `x`
+   @param labels  the output buffer, must hold `rows` values
+   @param threads the number of threads to use
+   */
+  virtual void predictBatch(const double *x, size_t rows, int *labels, unsigned threads = 1);
+  
+  /**
+   Scores `rows` feature vectors stored contiguously in row-major order in `x`
+   and writes the raw margins (w . x + b) to `margins`.
+   Note: This should be called only after training a model.
+   
+   @param x       the row-major feature matrix
+   @param rows    the number of rows in `x`
+   @param margins the output buffer, must hold `rows` values
+   @param threads the number of threads to use (0 = one per core)
+   */
+  virtual void predictBatch(const double *x, size_t rows, double *margins, unsigned threads = 1);
 };
 
 
@@ -104,7 +187,27 @@ private:
   // the vector of counts
   vector<double> m;
   // the kernel function
-  function<double(vector<double>, vector<double>)> kernel;
+  function<double(const vector<double> &, const vector<double> &)> kernel;
+  // the training samples w/ m_j > 0, one row each (row-major)
+  vector<double> supportVectors;
+  // m_j * y_j of each support vector
+  vector<double> coefficients;
+  // |x_j|^2 of each support vector
+  vector<double> svSquaredNorms;
+  
+  /**
+   Computes the margins sum_j m_j y_j kernel(x_j, x) + b for rows [begin, end)
+   of the row-major matrix `x` into `margins[begin]` to `margins[end - 1]`.
+   For the built-in kernels, the dot products of a block of rows w/ all the
+   support vectors are found by one cache-blocked matrix multiply and turned
+   into kernel values afterwards. Any other kernel is called once per pair.
+   
+   @param x       the row-major feature matrix
+   @param begin   the first row
+   @param end     one past the last row
+   @param margins the output buffer
+   */
+  void kernelMargins(const double *x, size_t begin, size_t end, double *margins);
   
 public:
   /**
@@ -112,7 +215,7 @@ public:
    
    @param kernel the kernel
    */
-  DualPerceptron(function<double(vector<double>, vector<double>)> kernel);
+  DualPerceptron(function<double(const vector<double> &, const vector<double> &)> kernel);
   
   /**
    Trains the perceptron with features 'x' and labels 'y'.
@@ -120,8 +223,73 @@ public:
    @param x the features to train
    @param y the corresponding labels
    */
-  void train(vector<vector<double>> x, vector<int> y);
+  void train(const vector<vector<double>> &x, const vector<int> &y);
+  
+  /**
+   Trains the perceptron with features 'x' and labels 'y' using the
+   precomputed kernel matrix `gram` instead of calculating its own. This lets
+   several models trained on the same features share one matrix.
+   
+   @param x    the features to train
+   @param y    the corresponding labels
+   @param gram the x.size() * x.size() row-major matrix of kernel(x[i], x[j])
+   */
+  void train(const vector<vector<double>> &x, const vector<int> &y, const double *gram);
+  
+  /**
+   Returns the mistake count of each training sample after training.
+   Note: This should be called only after training a model.
+   
+   @return the mistake counts
+   */
+  vector<double> getCounts();
+  
+  /**
+   Predicts the class (+1 or -1) of a single feature vector `x` from the
+   kernel expansion over the support vectors.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted class
+   */
+  int predict(const vector<double> &x);
+  
+  /**
+   Scores `rows` feature vectors stored contiguously in row-major order in `x`
+   against the support vectors and writes the predicted classes (+1 or -1) to
+   `labels`. Blocks of rows are scored as one blocked matrix multiply each
+   (see `kernelMargins`), split across `threads` threads (0 = one per core).
+   Note: This should be called only after training a model.
+   
+   @param x       the row-major feature matrix
+   @param rows    the number of rows in `x`
+   @param labels  the output buffer, must hold `rows` values
+   @param threads the number of threads to use
+   */
+  void predictBatch(const double *x, size_t rows, int *labels, unsigned threads = 1);
   
+  /**
+   Scores `rows` feature vectors stored contiguously in row-major order in `x`
+   and writes the raw margins (sum_j m_j y_j kernel(x_j, x) + b) to `margins`.
+   Note: This should be called only after training a model.
+   
+   @param x       the row-major feature matrix
+   @param rows    the number of rows in `x`
+   @param margins the output buffer, must hold `rows` values
+   @param threads the number of threads to use (0 = one per core)
+   */
+  void predictBatch(const double *x, size_t rows, double *margins, unsigned threads = 1);
 };
 
+/**
+ Calculates the row-major matrix of `kernel(x[i], x[j])` for all i, j.
+ The rows are split across `threads` threads (0 = one per core).
+ 
+ @param x       the feature vectors
+ @param kernel  the kernel
+ @param threads the number of threads to use
+ @return the x.size() * x.size() kernel matrix
+ */
+vector<double> gramMatrix(const vector<vector<double>> &x, function<double(const vector<double> &, const vector<double> &)> kernel, unsigned threads = 1);
+
 #endif /* Perceptron_hpp */
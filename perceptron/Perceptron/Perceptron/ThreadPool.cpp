@@ -0,0 +1,85 @@
+//
+//  ThreadPool.cpp
+//  Perceptron
+//
+//  Created by Brian Desnoyers on 2/23/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  this->pendingTasks = 0;
+  this->stopping = false;
+  for (unsigned i = 0; i < threads; i++) {
+    this->workers.push_back(thread(&ThreadPool::workerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> lock(this->queueMutex);
+    this->stopping = true;
+  }
+  this->taskAvailable.notify_all();
+  for (int i = 0; i < this->workers.size(); i++) {
+    this->workers[i].join();
+  }
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock(this->queueMutex);
+      this->taskAvailable.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+      if (this->tasks.empty()) { // stopping w/ nothing left to do
+        return;
+      }
+      task = move(this->tasks.front());
+      this->tasks.pop();
+    }
+    
+    exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = current_exception();
+    }
+    
+    unique_lock<mutex> lock(this->queueMutex);
+    if (error && !this->firstError) {
+      this->firstError = error;
+    }
+    this->pendingTasks--;
+    if (this->pendingTasks == 0) {
+      this->tasksFinished.notify_all();
+    }
+  }
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+  {
+    unique_lock<mutex> lock(this->queueMutex);
+    this->tasks.push(move(task));
+    this->pendingTasks++;
+  }
+  this->taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+  unique_lock<mutex> lock(this->queueMutex);
+  this->tasksFinished.wait(lock, [this] { return this->pendingTasks == 0; });
+  if (this->firstError) {
+    exception_ptr error = this->firstError;
+    this->firstError = nullptr;
+    rethrow_exception(error);
+  }
+}
+
+size_t ThreadPool::size() {
+  return this->workers.size();
+}
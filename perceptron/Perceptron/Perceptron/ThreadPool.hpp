@@ -0,0 +1,84 @@
+//
+//  ThreadPool.hpp
+//  Perceptron
+//
+//  Created by Brian Desnoyers on 2/23/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ A fixed-size pool of worker threads that run queued tasks.
+ */
+class ThreadPool {
+private:
+  // the worker threads
+  vector<thread> workers;
+  // the tasks waiting for a worker
+  queue<function<void()>> tasks;
+  // guards `tasks`, `pendingTasks`, `stopping` and `firstError`
+  mutex queueMutex;
+  // signalled when a task is queued or the pool is stopping
+  condition_variable taskAvailable;
+  // signalled when the last pending task finishes
+  condition_variable tasksFinished;
+  // the number of tasks queued or running
+  size_t pendingTasks;
+  // set when the pool is being destroyed
+  bool stopping;
+  // the first exception thrown by a task since the last `wait`
+  exception_ptr firstError;
+  
+  /**
+   The loop run by each worker: pop a task, run it, repeat.
+   */
+  void workerLoop();
+  
+public:
+  /**
+   Starts a pool with `threads` workers (0 = one per core).
+   
+   @param threads the number of worker threads
+   */
+  ThreadPool(unsigned threads = 0);
+  
+  /**
+   Finishes the queued tasks and joins the workers.
+   */
+  ~ThreadPool();
+  
+  /**
+   Queues `task` to be run by the next free worker.
+   
+   @param task the task to run
+   */
+  void enqueue(function<void()> task);
+  
+  /**
+   Blocks until every queued task has finished. If a task threw, the first
+   exception is rethrown here.
+   */
+  void wait();
+  
+  /**
+   Returns the number of worker threads.
+   
+   @return the number of worker threads
+   */
+  size_t size();
+};
+
+#endif /* ThreadPool_hpp */
@@ -94,6 +94,20 @@ int main(int argc, const char * argv[]) {
   vector<double> modelNormWeights = model.getNormalizedWeights();
   cout << "Normalized weights: ";
   printWeights(modelNormWeights);
+  // Score the whole training set in one batch
+  vector<double> flatFeatures;
+  for (int i = 0; i < features.size(); i++) {
+    flatFeatures.insert(flatFeatures.end(), features[i].begin(), features[i].end());
+  }
+  vector<int> predictions(features.size());
+  model.predictBatch(flatFeatures.data(), features.size(), predictions.data(), 0);
+  int correct = 0;
+  for (int i = 0; i < predictions.size(); i++) {
+    if (predictions[i] == labels[i]) {
+      correct++;
+    }
+  }
+  cout << "Training accuracy = " << correct << "/" << labels.size() << endl;
   cout << endl;
   
   cout << "Training " << trainingSetFilename << " w/ dual-form perceptron (linear kernel)" << endl;
@@ -120,6 +134,20 @@ int main(int argc, const char * argv[]) {
   vector<double> dpModelNormWeights2 = dpModel2.getNormalizedWeights();
   cout << "Normalized weights: ";
   printWeights(dpModelNormWeights2);
+  // Score the whole training set in one batch w/ the kernel
+  vector<double> flatFeatures2;
+  for (int i = 0; i < features2.size(); i++) {
+    flatFeatures2.insert(flatFeatures2.end(), features2[i].begin(), features2[i].end());
+  }
+  vector<int> predictions2(features2.size());
+  dpModel2.predictBatch(flatFeatures2.data(), features2.size(), predictions2.data(), 0);
+  int correct2 = 0;
+  for (int i = 0; i < predictions2.size(); i++) {
+    if (predictions2[i] == labels2[i]) {
+      correct2++;
+    }
+  }
+  cout << "Training accuracy = " << correct2 << "/" << labels2.size() << endl;
   cout << endl;
   
   return 0;
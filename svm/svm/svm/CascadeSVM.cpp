@@ -0,0 +1,368 @@
+//
+//  CascadeSVM.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "CascadeSVM.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A message is a uint64_t byte count followed by that many bytes.
+//
+// A solve request holds (int32 rows, int32 features) and then, for each row,
+// (int32 id, int32 label, double alpha, `features` x int32). An empty request
+// asks the worker to exit.
+//
+// Its reply holds (int32 count) and then (int32 id, double alpha) for each
+// support vector.
+
+/**
+ Appends the bytes of `value` to `message`.
+ */
+template <typename T>
+void put(vector<char> &message, const T &value) {
+  const char *bytes = (const char *)&value;
+  message.insert(message.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ Reads a `T` from `message` at `offset` and moves `offset` past it.
+ */
+template <typename T>
+T take(const vector<char> &message, size_t &offset) {
+  T value;
+  memcpy(&value, message.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+/**
+ Writes all `count` bytes of `buffer` to `socket`.
+ 
+ @return false if the socket was closed or failed
+ */
+bool writeAll(int socket, const char *buffer, size_t count) {
+  while (count > 0) {
+#ifdef MSG_NOSIGNAL
+    ssize_t written = send(socket, buffer, count, MSG_NOSIGNAL);
+#else
+    ssize_t written = write(socket, buffer, count);
+#endif
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    buffer += written;
+    count -= written;
+  }
+  return true;
+}
+
+/**
+ Reads exactly `count` bytes from `socket` into `buffer`.
+ 
+ @return false if the socket was closed or failed first
+ */
+bool readAll(int socket, char *buffer, size_t count) {
+  while (count > 0) {
+    ssize_t received = read(socket, buffer, count);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    buffer += received;
+    count -= received;
+  }
+  return true;
+}
+
+/**
+ Sends `message` w/ its length prefix.
+ */
+bool sendMessage(int socket, const vector<char> &message) {
+  uint64_t length = message.size();
+  return writeAll(socket, (const char *)&length, sizeof(length)) && writeAll(socket, message.data(), message.size());
+}
+
+/**
+ Receives one length-prefixed message into `message`.
+ */
+bool receiveMessage(int socket, vector<char> &message) {
+  uint64_t length;
+  if (!readAll(socket, (char *)&length, sizeof(length))) {
+    return false;
+  }
+  message.resize(length);
+  return readAll(socket, message.data(), length);
+}
+
+/**
+ Returns the union of `a` and `b`, taking the alpha of a sample in both
+ from `b`.
+ */
+CascadeSet mergeSets(const CascadeSet &a, const CascadeSet &b) {
+  CascadeSet merged;
+  int i = 0;
+  int j = 0;
+  while (i < a.ids.size() || j < b.ids.size()) {
+    if (j == b.ids.size() || (i < a.ids.size() && a.ids[i] < b.ids[j])) {
+      merged.ids.push_back(a.ids[i]);
+      merged.alphas.push_back(a.alphas[i]);
+      i++;
+    } else {
+      if (i < a.ids.size() && a.ids[i] == b.ids[j]) {
+        i++;
+      }
+      merged.ids.push_back(b.ids[j]);
+      merged.alphas.push_back(b.alphas[j]);
+      j++;
+    }
+  }
+  return merged;
+}
+
+CascadeSVM::CascadeSVM(const BinSVM &prototype, int workers, int maxRounds) : prototype(prototype), model(prototype) {
+  assert(workers > 0);
+  this->workers = workers;
+  this->maxRounds = maxRounds;
+  this->rounds = 0;
+  this->verbose = true;
+  this->prototype.setVerbose(false);
+}
+
+void CascadeSVM::startWorkers() {
+  for (int k = 0; k < this->workers; k++) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+      this->stopWorkers();
+      throw runtime_error(string("socketpair: ") + strerror(errno));
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(pair[0]);
+      close(pair[1]);
+      this->stopWorkers();
+      throw runtime_error(string("fork: ") + strerror(errno));
+    }
+    if (pid == 0) {
+      // Keep only this worker's end, so the others see EOF once the
+      // coordinator closes theirs
+      for (int socket : this->sockets) {
+        close(socket);
+      }
+      close(pair[0]);
+      try {
+        this->serve(pair[1]);
+      } catch (...) {
+        _exit(1);
+      }
+      _exit(0);
+    }
+    close(pair[1]);
+    this->workerIds.push_back(pid);
+    this->sockets.push_back(pair[0]);
+  }
+}
+
+void CascadeSVM::stopWorkers() {
+  for (int k = 0; k < this->sockets.size(); k++) {
+    sendMessage(this->sockets[k], vector<char>());
+    close(this->sockets[k]);
+  }
+  for (pid_t pid : this->workerIds) {
+    waitpid(pid, NULL, 0);
+  }
+  this->sockets.clear();
+  this->workerIds.clear();
+}
+
+void CascadeSVM::serve(int socket) {
+  vector<char> request;
+  while (receiveMessage(socket, request) && !request.empty()) {
+    size_t offset = 0;
+    int rows = take<int32_t>(request, offset);
+    int featureCount = take<int32_t>(request, offset);
+    vector<int> ids(rows);
+    vector<int> labels(rows);
+    vector<double> alphas(rows);
+    vector<vector<int>> features(rows, vector<int>(featureCount));
+    for (int r = 0; r < rows; r++) {
+      ids[r] = take<int32_t>(request, offset);
+      labels[r] = take<int32_t>(request, offset);
+      alphas[r] = take<double>(request, offset);
+      for (int f = 0; f < featureCount; f++) {
+        features[r][f] = take<int32_t>(request, offset);
+      }
+    }
+    
+    // A subset w/ a single class has no support vectors
+    vector<char> reply;
+    bool bothClasses = rows > 0 && find(labels.begin(), labels.end(), -labels[0]) != labels.end();
+    if (bothClasses) {
+      BinSVM solver = this->prototype;
+      solver.setWarmStart(alphas, 0.0);
+      solver.train(move(features), labels);
+      alphas = solver.getAlphas();
+    }
+    int count = 0;
+    for (int r = 0; r < rows && bothClasses; r++) {
+      count += alphas[r] > 0;
+    }
+    put<int32_t>(reply, count);
+    for (int r = 0; r < rows && bothClasses; r++) {
+      if (alphas[r] > 0) {
+        put<int32_t>(reply, ids[r]);
+        put<double>(reply, alphas[r]);
+      }
+    }
+    if (!sendMessage(socket, reply)) {
+      break;
+    }
+  }
+  close(socket);
+}
+
+vector<CascadeSet> CascadeSVM::solve(const vector<CascadeSet> &tasks, const vector<vector<int>> &features, const vector<int> &labels) {
+  assert(tasks.size() <= this->sockets.size());
+  int featureCount = (int)features[0].size();
+  
+  // Send every task before reading any reply, so the workers solve at once
+  for (int k = 0; k < tasks.size(); k++) {
+    const CascadeSet &task = tasks[k];
+    vector<char> request;
+    request.reserve(2 * sizeof(int32_t) + task.ids.size() * (2 * sizeof(int32_t) + sizeof(double) + featureCount * sizeof(int32_t)));
+    put<int32_t>(request, (int32_t)task.ids.size());
+    put<int32_t>(request, featureCount);
+    for (int r = 0; r < task.ids.size(); r++) {
+      int id = task.ids[r];
+      put<int32_t>(request, id);
+      put<int32_t>(request, labels[id]);
+      put<double>(request, task.alphas[r]);
+      const vector<int> &x = features[id];
+      request.insert(request.end(), (const char *)x.data(), (const char *)(x.data() + featureCount));
+    }
+    if (!sendMessage(this->sockets[k], request)) {
+      throw runtime_error("Lost a cascade worker");
+    }
+  }
+  
+  vector<CascadeSet> solutions(tasks.size());
+  vector<char> reply;
+  for (int k = 0; k < tasks.size(); k++) {
+    if (!receiveMessage(this->sockets[k], reply)) {
+      throw runtime_error("Lost a cascade worker");
+    }
+    size_t offset = 0;
+    int count = take<int32_t>(reply, offset);
+    for (int r = 0; r < count; r++) {
+      solutions[k].ids.push_back(take<int32_t>(reply, offset));
+      solutions[k].alphas.push_back(take<double>(reply, offset));
+    }
+  }
+  return solutions;
+}
+
+void CascadeSVM::train(const vector<vector<int>> &features, const vector<int> &labels) {
+  assert(features.size() == labels.size());
+  size_t m = labels.size();
+  
+  // Split a shuffled training set evenly across the workers
+  vector<int> order(m);
+  for (int i = 0; i < m; i++) {
+    order[i] = i;
+  }
+  random_device seedGenerator;
+  mt19937_64 mersenneTwisterGenerator{seedGenerator()};
+  shuffle(order.begin(), order.end(), mersenneTwisterGenerator);
+  vector<CascadeSet> partitions(this->workers);
+  for (int k = 0; k < this->workers; k++) {
+    partitions[k].ids.assign(order.begin() + k * m / this->workers, order.begin() + (k + 1) * m / this->workers);
+    sort(partitions[k].ids.begin(), partitions[k].ids.end());
+    partitions[k].alphas.assign(partitions[k].ids.size(), 0.0);
+  }
+  
+  this->startWorkers();
+  CascadeSet top;
+  try {
+    for (this->rounds = 1; this->rounds <= this->maxRounds; this->rounds++) {
+      // Every partition starts from the support vectors at the top of the
+      // last pass, at their alphas
+      vector<CascadeSet> layer(this->workers);
+      for (int k = 0; k < this->workers; k++) {
+        layer[k] = mergeSets(partitions[k], top);
+      }
+      layer = this->solve(layer, features, labels);
+      
+      // Merge the solutions in pairs until one is left
+      while (layer.size() > 1) {
+        vector<CascadeSet> merged;
+        for (int k = 0; k + 1 < layer.size(); k += 2) {
+          merged.push_back(mergeSets(layer[k], layer[k + 1]));
+        }
+        merged = this->solve(merged, features, labels);
+        if (layer.size() % 2 == 1) {
+          merged.push_back(layer.back());
+        }
+        layer = merged;
+      }
+      
+      bool converged = layer[0].ids == top.ids;
+      top = layer[0];
+      if (this->verbose) {
+        cout << "Cascade pass " << this->rounds << ": " << top.ids.size() << " support vectors" << endl;
+      }
+      if (converged) {
+        break;
+      }
+    }
+  } catch (...) {
+    this->stopWorkers();
+    throw;
+  }
+  this->stopWorkers();
+  this->rounds = min(this->rounds, this->maxRounds);
+  
+  // The final model only needs the support vectors at the top, and starts
+  // at their solution
+  vector<vector<int>> supportFeatures(top.ids.size());
+  vector<int> supportLabels(top.ids.size());
+  for (int r = 0; r < top.ids.size(); r++) {
+    supportFeatures[r] = features[top.ids[r]];
+    supportLabels[r] = labels[top.ids[r]];
+  }
+  this->model = this->prototype;
+  this->model.setWarmStart(top.alphas, 0.0);
+  this->model.train(move(supportFeatures), supportLabels);
+}
+
+int CascadeSVM::predictClass(const vector<int> &x) {
+  return this->model.predictClass(x);
+}
+
+int CascadeSVM::getRounds() {
+  return this->rounds;
+}
+
+BinSVM CascadeSVM::getModel() {
+  return this->model;
+}
+
+void CascadeSVM::setVerbose(bool verbose) {
+  this->verbose = verbose;
+}
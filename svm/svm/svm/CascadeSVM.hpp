@@ -0,0 +1,148 @@
+//
+//  CascadeSVM.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef CascadeSVM_hpp
+#define CascadeSVM_hpp
+
+#include "SimpSVM.hpp"
+#include <stdio.h>
+#include <sys/types.h>
+#include <vector>
+
+using namespace std;
+
+// The default number of worker processes
+const int DEFAULT_CASCADE_WORKERS = 4;
+// The default max # of passes through the cascade
+const int DEFAULT_CASCADE_ROUNDS = 5;
+
+/**
+ A subset of the training set and its alphas, which is what travels between
+ the layers of the cascade.
+ */
+struct CascadeSet {
+  vector<int> ids; // The training sample indices, in increasing order
+  vector<double> alphas; // The alpha of each sample
+};
+
+/**
+ A binary SVM trained as a cascade (Graf et al., 2005) across worker
+ processes, so no process holds the kernel matrix of the whole training set.
+ 
+ The training set is split into one partition per worker, and each worker
+ solves its partition. The support vectors of the solutions are merged in
+ pairs and solved again, warm started from the alphas of both halves, up a
+ binary tree until one set is left. Its support vectors are fed back into
+ every partition for the next pass, until the set at the top stops changing.
+ 
+ The workers are forked processes, each talking to the coordinator over its
+ own local socket. Every message is a length-prefixed buffer that carries the
+ samples themselves (ids, labels, alphas and features), so a worker needs
+ nothing but its socket and its copy of the prototype's settings.
+ */
+class CascadeSVM {
+private:
+  // the model every solve in the cascade is copied from
+  BinSVM prototype;
+  // the final model, trained on the support vectors at the top of the cascade
+  BinSVM model;
+  // the number of worker processes (and partitions)
+  int workers;
+  // the max # of passes through the cascade
+  int maxRounds;
+  // the # of passes the last training made
+  int rounds;
+  // whether training prints its progress
+  bool verbose;
+  // the process id of each worker, during training
+  vector<pid_t> workerIds;
+  // the coordinator's end of each worker's socket, during training
+  vector<int> sockets;
+  
+  /**
+   Forks the workers, each connected to the coordinator by a socket pair.
+   */
+  void startWorkers();
+  
+  /**
+   Closes the workers' sockets, which makes them exit, and waits for them.
+   */
+  void stopWorkers();
+  
+  /**
+   Serves solve requests on `socket` until it's closed. Runs in a worker.
+   
+   @param socket the worker's end of the socket
+   */
+  void serve(int socket);
+  
+  /**
+   Solves each of `tasks` on its own worker and returns the support vectors
+   of each solution w/ their alphas.
+   
+   @param tasks    the subsets to solve, w/ their starting alphas
+   @param features the training features
+   @param labels   the training labels
+   @return the support vectors of each solution
+   */
+  vector<CascadeSet> solve(const vector<CascadeSet> &tasks, const vector<vector<int>> &features, const vector<int> &labels);
+  
+public:
+  /**
+   Initializes a cascade SVM. Every solve is done by a copy of `prototype`,
+   so its solver, kernel, C and other settings apply to all of them.
+   
+   @param prototype the configured (untrained) binary model
+   @param workers   the number of worker processes
+   @param maxRounds the max # of passes through the cascade
+   */
+  CascadeSVM(const BinSVM &prototype, int workers = DEFAULT_CASCADE_WORKERS, int maxRounds = DEFAULT_CASCADE_ROUNDS);
+  
+  /**
+   Trains the model on the feature vectors `features` and their labels
+   (+1 or -1) by running the cascade until its support vectors stop changing
+   (or for `maxRounds` passes).
+   
+   @param features the feature vectors to train
+   @param labels   the corresponding labels
+   */
+  void train(const vector<vector<int>> &features, const vector<int> &labels);
+  
+  /**
+   Predicts the class associated with feature vector `x`.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted class
+   */
+  int predictClass(const vector<int> &x);
+  
+  /**
+   Returns the number of passes through the cascade in the last training.
+   
+   @return the number of passes
+   */
+  int getRounds();
+  
+  /**
+   Returns the final model.
+   Note: This should be called only after training a model.
+   
+   @return the model
+   */
+  BinSVM getModel();
+  
+  /**
+   Turns the per-pass training output on or off (on by default).
+   
+   @param verbose whether to print the progress of training
+   */
+  void setVerbose(bool verbose);
+};
+
+#endif /* CascadeSVM_hpp */
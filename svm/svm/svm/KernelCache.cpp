@@ -0,0 +1,155 @@
+//
+//  KernelCache.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "KernelCache.hpp"
+#include <algorithm>
+
+KernelCache::KernelCache(size_t rowCount, size_t rowBytes, double megabytes, function<void(int, void *)> fillRow) {
+  this->rowCount = rowCount;
+  this->rowBytes = alignedStride<char>(rowBytes);
+  size_t budgetRows = (size_t)(megabytes * 1024 * 1024) / this->rowBytes;
+  this->capacity = max((size_t)2, min(budgetRows, rowCount));
+  this->storage.resize(this->capacity * this->rowBytes);
+  this->slotOfRow.assign(rowCount, -1);
+  this->rowOfSlot.assign(this->capacity, -1);
+  this->newer.assign(this->capacity, -1);
+  this->older.assign(this->capacity, -1);
+  this->newest = -1;
+  this->oldest = -1;
+  this->usedSlots = 0;
+  this->fillRow = fillRow;
+  this->hits = 0;
+  this->misses = 0;
+}
+
+void KernelCache::unlink(int slot) {
+  if (this->newer[slot] >= 0) {
+    this->older[this->newer[slot]] = this->older[slot];
+  } else {
+    this->newest = this->older[slot];
+  }
+  if (this->older[slot] >= 0) {
+    this->newer[this->older[slot]] = this->newer[slot];
+  } else {
+    this->oldest = this->newer[slot];
+  }
+  this->newer[slot] = -1;
+  this->older[slot] = -1;
+}
+
+void KernelCache::pushNewest(int slot) {
+  this->older[slot] = this->newest;
+  this->newer[slot] = -1;
+  if (this->newest >= 0) {
+    this->newer[this->newest] = slot;
+  }
+  this->newest = slot;
+  if (this->oldest < 0) {
+    this->oldest = slot;
+  }
+}
+
+int KernelCache::claimSlot(int i) {
+  int slot;
+  if (this->usedSlots < this->capacity) {
+    slot = (int)this->usedSlots++;
+  } else {
+    slot = this->oldest;
+    this->unlink(slot);
+    if (this->rowOfSlot[slot] >= 0) {
+      this->slotOfRow[this->rowOfSlot[slot]] = -1;
+    }
+  }
+  this->slotOfRow[i] = slot;
+  this->rowOfSlot[slot] = i;
+  this->pushNewest(slot);
+  return slot;
+}
+
+const void *KernelCache::getRow(int i) {
+  int slot = this->slotOfRow[i];
+  if (slot >= 0) {
+    this->hits++;
+    if (slot != this->newest) {
+      this->unlink(slot);
+      this->pushNewest(slot);
+    }
+    return this->storage.data() + slot * this->rowBytes;
+  }
+  
+  this->misses++;
+  char *row = this->storage.data() + this->claimSlot(i) * this->rowBytes;
+  this->fillRow(i, row);
+  return row;
+}
+
+void KernelCache::readRow(int i, const function<void(const void *)> &reader) {
+  unique_lock<mutex> lock(this->cacheMutex);
+  int slot = this->slotOfRow[i];
+  if (slot < 0) {
+    // Calculate the row outside of the lock, then copy it in
+    lock.unlock();
+    vector<char, AlignedAllocator<char>> buffer(this->rowBytes);
+    this->fillRow(i, buffer.data());
+    lock.lock();
+    slot = this->slotOfRow[i];
+    if (slot < 0) {
+      this->misses++;
+      slot = this->claimSlot(i);
+      copy(buffer.begin(), buffer.end(), this->storage.begin() + slot * this->rowBytes);
+    }
+  } else {
+    this->hits++;
+  }
+  if (slot != this->newest) {
+    this->unlink(slot);
+    this->pushNewest(slot);
+  }
+  reader(this->storage.data() + slot * this->rowBytes);
+}
+
+void KernelCache::invalidate(int i) {
+  int slot = this->slotOfRow[i];
+  if (slot < 0) {
+    return;
+  }
+  this->unlink(slot);
+  this->slotOfRow[i] = -1;
+  this->rowOfSlot[slot] = -1;
+  
+  // Link it in as the least recently used, so it's evicted first
+  this->newer[slot] = this->oldest;
+  this->older[slot] = -1;
+  if (this->oldest >= 0) {
+    this->older[this->oldest] = slot;
+  }
+  this->oldest = slot;
+  if (this->newest < 0) {
+    this->newest = slot;
+  }
+}
+
+void KernelCache::updateRows(const function<void(int, void *)> &update) {
+  for (int slot = 0; slot < this->usedSlots; slot++) {
+    if (this->rowOfSlot[slot] >= 0) {
+      update(this->rowOfSlot[slot], this->storage.data() + slot * this->rowBytes);
+    }
+  }
+}
+
+size_t KernelCache::getHits() {
+  return this->hits;
+}
+
+size_t KernelCache::getMisses() {
+  return this->misses;
+}
+
+size_t KernelCache::getCapacity() {
+  return this->capacity;
+}
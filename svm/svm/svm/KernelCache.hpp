@@ -0,0 +1,133 @@
+//
+//  KernelCache.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef KernelCache_hpp
+#define KernelCache_hpp
+
+#include "AlignedAllocator.hpp"
+#include <functional>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ A least recently used cache of kernel matrix rows w/ a fixed memory budget.
+ Rows are calculated on demand by a caller-supplied function, so training
+ never needs the whole matrix in memory.
+ */
+class KernelCache {
+private:
+  size_t rowCount; // the number of rows in the full matrix
+  size_t rowBytes; // the size of one (padded) row
+  size_t capacity; // the max # of rows held at once
+  vector<char, AlignedAllocator<char>> storage; // `capacity` aligned row slots
+  vector<int> slotOfRow; // the slot holding each row, -1 if not cached
+  vector<int> rowOfSlot; // the row held by each slot, -1 if empty
+  vector<int> newer; // the next more recently used slot, -1 for the newest
+  vector<int> older; // the next less recently used slot, -1 for the oldest
+  int newest; // the most recently used slot
+  int oldest; // the least recently used slot
+  size_t usedSlots; // the number of slots that have held a row
+  function<void(int, void *)> fillRow; // calculates a row into a slot
+  size_t hits; // the number of row requests served from the cache
+  size_t misses; // the number of row requests that had to calculate the row
+  mutex cacheMutex; // guards the cache in `readRow`
+  
+  /**
+   Unlinks `slot` from the recency list.
+   */
+  void unlink(int slot);
+  
+  /**
+   Takes an unused slot, or evicts the least recently used row, for row `i`.
+   
+   @param i the row index
+   @return the slot
+   */
+  int claimSlot(int i);
+  
+  /**
+   Links `slot` in as the most recently used.
+   */
+  void pushNewest(int slot);
+  
+public:
+  /**
+   Creates a cache for a matrix w/ `rowCount` rows of `rowBytes` bytes.
+   
+   @param rowCount  the number of rows in the full matrix
+   @param rowBytes  the size of one row in bytes
+   @param megabytes the memory budget, at least 2 rows are always kept
+   @param fillRow   calculates row i into the buffer it is given
+   */
+  KernelCache(size_t rowCount, size_t rowBytes, double megabytes, function<void(int, void *)> fillRow);
+  
+  /**
+   Returns row `i`, calculating it if it isn't cached. The pointer stays
+   valid until `capacity - 1` other rows have been requested, so the 2 rows
+   of an SMO step can always be held at once.
+   
+   @param i the row index
+   @return the row's data
+   */
+  const void *getRow(int i);
+  
+  /**
+   Calls `reader` w/ row `i`, calculating the row if it isn't cached. Unlike
+   `getRow`, this is safe to call from several threads at once: the row can't
+   be evicted while `reader` runs, and a missing row is calculated w/o
+   holding the cache's lock (two threads may occasionally both calculate it).
+   `reader` should be quick, since it blocks the other threads.
+   
+   @param i      the row index
+   @param reader reads the row's data
+   */
+  void readRow(int i, const function<void(const void *)> &reader);
+  
+  /**
+   Drops row `i` from the cache, if it's there, and makes its slot the next
+   one reused. For a matrix whose rows change, e.g. when a row index is
+   reused for a new sample.
+   
+   @param i the row index
+   */
+  void invalidate(int i);
+  
+  /**
+   Calls `update(i, row)` on every cached row, so a change to one column of
+   the matrix can be patched into the cached rows instead of dropping them.
+   
+   @param update patches the data of row i
+   */
+  void updateRows(const function<void(int, void *)> &update);
+  
+  /**
+   Returns the number of row requests served from the cache.
+   
+   @return the hit count
+   */
+  size_t getHits();
+  
+  /**
+   Returns the number of row requests that had to calculate the row.
+   
+   @return the miss count
+   */
+  size_t getMisses();
+  
+  /**
+   Returns the max # of rows the cache holds at once.
+   
+   @return the capacity in rows
+   */
+  size_t getCapacity();
+};
+
+#endif /* KernelCache_hpp */
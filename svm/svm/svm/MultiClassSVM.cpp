@@ -0,0 +1,175 @@
+//
+//  MultiClassSVM.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "MultiClassSVM.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// The fewest rows worth handing to a separate thread in `predictBatch`
+const size_t MIN_ROWS_PER_THREAD = 64;
+
+/**
+ Returns the index of the first largest value in `v`.
+ */
+int argmax(const int *v, size_t n) {
+  int maxIndex = 0;
+  for (int i = 1; i < n; i++) {
+    if (v[i] > v[maxIndex]) {
+      maxIndex = i;
+    }
+  }
+  return maxIndex;
+}
+
+MultiClassSVM::MultiClassSVM(const BinSVM &prototype, unsigned threads, double sharedCacheMegabytes) : prototype(prototype) {
+  this->threads = threads;
+  this->sharedCacheMegabytes = sharedCacheMegabytes;
+  this->verbose = true;
+}
+
+void MultiClassSVM::train(vector<vector<int>> features, const vector<int> &labels) {
+  assert(features.size() == labels.size());
+  this->classes = labels;
+  sort(this->classes.begin(), this->classes.end());
+  this->classes.erase(unique(this->classes.begin(), this->classes.end()), this->classes.end());
+  size_t classCount = this->classes.size();
+  
+  // One read-only copy of the features, grouped by class, so each class is
+  // a block of the shared kernel cache and each pair of classes trains on
+  // two blocks
+  vector<vector<int>> members(classCount);
+  for (int i = 0; i < labels.size(); i++) {
+    int c = (int)(lower_bound(this->classes.begin(), this->classes.end(), labels[i]) - this->classes.begin());
+    members[c].push_back(i);
+  }
+  vector<vector<int>> grouped;
+  grouped.reserve(features.size());
+  vector<size_t> classStart(1, 0);
+  for (int c = 0; c < classCount; c++) {
+    for (int i : members[c]) {
+      grouped.push_back(move(features[i]));
+    }
+    classStart.push_back(grouped.size());
+  }
+  vector<vector<int>>().swap(features);
+  shared_ptr<const vector<vector<int>>> store = make_shared<const vector<vector<int>>>(move(grouped));
+  SharedKernel sharedKernel = this->prototype.shareKernel(store, classStart, this->sharedCacheMegabytes);
+  
+  this->pairs.clear();
+  for (int a = 0; a < classCount; a++) {
+    for (int b = a + 1; b < classCount; b++) {
+      this->pairs.push_back(make_pair(a, b));
+    }
+  }
+  this->models.assign(this->pairs.size(), this->prototype);
+  for (BinSVM &model : this->models) {
+    model.setVerbose(this->verbose);
+  }
+  
+  // Queue the largest sub-problems first, so a big one isn't left running
+  // alone at the end
+  vector<int> order(this->pairs.size());
+  for (int p = 0; p < order.size(); p++) {
+    order[p] = p;
+  }
+  auto pairSize = [this, &classStart](int p) {
+    int a = this->pairs[p].first;
+    int b = this->pairs[p].second;
+    return (classStart[a + 1] - classStart[a]) + (classStart[b + 1] - classStart[b]);
+  };
+  stable_sort(order.begin(), order.end(), [&pairSize](int p, int q) { return pairSize(p) > pairSize(q); });
+  
+  // Each task trains one model, which only it writes to
+  mutex outputMutex;
+  ThreadPool pool(this->threads);
+  for (int p : order) {
+    pool.enqueue([this, p, &classStart, &sharedKernel, &outputMutex]() {
+      int a = this->pairs[p].first;
+      int b = this->pairs[p].second;
+      vector<int> indices;
+      vector<int> binaryLabels;
+      for (int i = (int)classStart[a]; i < classStart[a + 1]; i++) {
+        indices.push_back(i);
+        binaryLabels.push_back(1);
+      }
+      for (int i = (int)classStart[b]; i < classStart[b + 1]; i++) {
+        indices.push_back(i);
+        binaryLabels.push_back(-1);
+      }
+      this->models[p].train(sharedKernel, indices, binaryLabels);
+      
+      if (this->verbose) {
+        lock_guard<mutex> lock(outputMutex);
+        cout << "Trained " << this->classes[a] << " vs " << this->classes[b] << " on " << indices.size() << " samples" << endl;
+      }
+    });
+  }
+  pool.wait();
+  if (this->verbose) {
+    cout << "Shared kernel cache: " << sharedKernel.cache->getHits() << " hits, " << sharedKernel.cache->getMisses() << " misses" << endl;
+  }
+}
+
+int MultiClassSVM::predict(const vector<int> &x) {
+  vector<int> votes(this->classes.size(), 0);
+  for (int p = 0; p < this->models.size(); p++) {
+    if (this->models[p].predictClass(x) > 0) {
+      votes[this->pairs[p].first]++;
+    } else {
+      votes[this->pairs[p].second]++;
+    }
+  }
+  return this->classes[argmax(votes.data(), votes.size())];
+}
+
+vector<int> MultiClassSVM::predictBatch(const vector<vector<int>> &x) {
+  size_t rows = x.size();
+  size_t classCount = this->classes.size();
+  vector<int> votes(rows * classCount, 0);
+  vector<int> predictions(rows);
+  
+  // Each chunk of rows is scored by one model at a time, as a blocked matrix
+  // multiply w/ its support vectors (see `BinSVM::decisionValues`), so a
+  // model's weights or support vectors stay in cache over the whole chunk.
+  // Chunks only write to their own rows of `votes`.
+  auto voteOnRows = [this, &x, &votes, &predictions, classCount](size_t begin, size_t end) {
+    vector<double> values(end - begin);
+    for (int p = 0; p < this->models.size(); p++) {
+      this->models[p].decisionValues(x, begin, end, values.data());
+      int first = this->pairs[p].first;
+      int second = this->pairs[p].second;
+      for (size_t r = begin; r < end; r++) {
+        votes[r * classCount + ((values[r - begin] > 0) ? first : second)]++;
+      }
+    }
+    for (size_t r = begin; r < end; r++) {
+      predictions[r] = this->classes[argmax(votes.data() + r * classCount, classCount)];
+    }
+  };
+  
+  unsigned threadCount = (this->threads == 0) ? max(1u, thread::hardware_concurrency()) : this->threads;
+  if (threadCount > 1 && rows >= 2 * MIN_ROWS_PER_THREAD) {
+    ThreadPool pool(threadCount - 1); // the calling thread takes a chunk too
+    pool.parallelFor(rows, MIN_ROWS_PER_THREAD, voteOnRows);
+  } else {
+    voteOnRows(0, rows);
+  }
+  return predictions;
+}
+
+vector<int> MultiClassSVM::getClasses() {
+  return this->classes;
+}
+
+void MultiClassSVM::setVerbose(bool verbose) {
+  this->verbose = verbose;
+}
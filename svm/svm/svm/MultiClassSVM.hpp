@@ -0,0 +1,104 @@
+//
+//  MultiClassSVM.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef MultiClassSVM_hpp
+#define MultiClassSVM_hpp
+
+#include "SimpSVM.hpp"
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+// The default memory budget of the kernel matrix cache shared by the models
+const double DEFAULT_SHARED_CACHE_MEGABYTES = 1000;
+
+/**
+ A one-vs-one multiclass classifier built from `BinSVM`s. One binary model
+ is trained for every pair of classes, all on a thread pool, and the class
+ w/ the most pairwise wins is predicted.
+ */
+class MultiClassSVM {
+private:
+  // the model every pairwise model is copied from before training
+  BinSVM prototype;
+  // the distinct labels seen in training
+  vector<int> classes;
+  // one model per pair of classes (a, b), a < b, in the order of `pairs`
+  vector<BinSVM> models;
+  // the indices into `classes` of the +1 and -1 class of each model
+  vector<pair<int, int>> pairs;
+  // the number of threads to train and predict with (0 = one per core)
+  unsigned threads;
+  // the memory budget of the shared kernel matrix cache
+  double sharedCacheMegabytes;
+  // whether training prints its progress, and the pairwise models theirs
+  bool verbose;
+  
+public:
+  /**
+   Initializes a one-vs-one classifier. Every pairwise model is a copy of
+   `prototype`, so its solver, kernel and other settings apply to all of
+   them. `prototype`'s own cache size is the budget of each model's private
+   row cache, which is filled from the shared one.
+   
+   @param prototype            the configured (untrained) binary model
+   @param threads              the number of threads to use (0 = one per core)
+   @param sharedCacheMegabytes the memory budget of the shared kernel cache
+   */
+  MultiClassSVM(const BinSVM &prototype, unsigned threads = 0, double sharedCacheMegabytes = DEFAULT_SHARED_CACHE_MEGABYTES);
+  
+  /**
+   Trains one `BinSVM` per pair of distinct labels in `labels`, the pairs w/
+   the most samples first. All of the models read the same copy of
+   `features` and share one kernel matrix cache over it.
+   
+   @param features the feature vectors to train
+   @param labels   the corresponding labels- any ints
+   */
+  void train(vector<vector<int>> features, const vector<int> &labels);
+  
+  /**
+   Predicts the class of `x` by majority vote of the pairwise models. Ties
+   go to the class that comes first in `getClasses()`.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vector
+   @return the predicted label
+   */
+  int predict(const vector<int> &x);
+  
+  /**
+   Predicts the classes of all of `x` in one batched pass: each pairwise
+   model votes on a chunk of rows before the next model is used, and the
+   chunks are split across threads.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vectors
+   @return the predicted labels
+   */
+  vector<int> predictBatch(const vector<vector<int>> &x);
+  
+  /**
+   Returns the labels seen in training, in the order ties are broken.
+   
+   @return the labels
+   */
+  vector<int> getClasses();
+  
+  /**
+   Turns the training output on or off (on by default): a line per trained
+   pair, the shared kernel cache statistics, and the progress of every
+   pairwise model.
+   
+   @param verbose whether to print the progress of training
+   */
+  void setVerbose(bool verbose);
+};
+
+#endif /* MultiClassSVM_hpp */
@@ -0,0 +1,171 @@
+//
+//  Nystrom.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "Nystrom.hpp"
+#include "SimpSVM.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <random>
+
+// Eigenvalues below this fraction of the largest are treated as 0
+const double EIGENVALUE_CUTOFF = 1e-10;
+
+// The Jacobi method stops once the off-diagonal mass is this small
+const double JACOBI_TOLERANCE = 1e-14;
+
+// The max # of Jacobi sweeps over the matrix
+const int JACOBI_MAX_SWEEPS = 100;
+
+vector<int> selectLandmarks(const vector<const vector<int> *> &features, int count, LandmarkSelection selection) {
+  int m = (int)features.size();
+  assert(count > 0 && count <= m);
+  
+  random_device seedGenerator;
+  mt19937_64 mersenneTwisterGenerator{seedGenerator()};
+  
+  if (selection == UNIFORM_LANDMARKS) {
+    // Partial Fisher-Yates shuffle
+    vector<int> indices(m);
+    for (int i = 0; i < m; i++) {
+      indices[i] = i;
+    }
+    for (int i = 0; i < count; i++) {
+      uniform_int_distribution<> pick{i, m - 1};
+      swap(indices[i], indices[pick(mersenneTwisterGenerator)]);
+    }
+    indices.resize(count);
+    return indices;
+  }
+  
+  // k-means++ seeding, w/ |u - v|^2 = |u|^2 + |v|^2 - 2 u . v
+  vector<double> squaredNorms(m);
+  for (int i = 0; i < m; i++) {
+    squaredNorms[i] = dotProduct(*features[i], *features[i]);
+  }
+  vector<double> closest(m, INFINITY); // squared distance to the nearest landmark
+  vector<int> landmarks;
+  uniform_int_distribution<> first{0, m - 1};
+  landmarks.push_back(first(mersenneTwisterGenerator));
+  while (landmarks.size() < count) {
+    const vector<int> &latest = *features[landmarks.back()];
+    double latestNorm = squaredNorms[landmarks.back()];
+    double total = 0;
+    for (int i = 0; i < m; i++) {
+      double distance = max(0.0, squaredNorms[i] + latestNorm - 2 * dotProduct(*features[i], latest));
+      closest[i] = min(closest[i], distance);
+      total += closest[i];
+    }
+    
+    int next = -1;
+    if (total > 0) {
+      uniform_real_distribution<> draw{0, total};
+      double target = draw(mersenneTwisterGenerator);
+      for (int i = 0; i < m && next < 0; i++) {
+        target -= closest[i];
+        if (target <= 0 && closest[i] > 0) {
+          next = i;
+        }
+      }
+    }
+    if (next < 0) { // every remaining point duplicates a landmark
+      for (int i = 0; i < m && next < 0; i++) {
+        if (find(landmarks.begin(), landmarks.end(), i) == landmarks.end()) {
+          next = i;
+        }
+      }
+    }
+    closest[next] = 0;
+    landmarks.push_back(next);
+  }
+  return landmarks;
+}
+
+void symmetricEigen(vector<double> a, int n, vector<double> &eigenvalues, vector<double> &eigenvectors) {
+  eigenvectors.assign(n * n, 0.0);
+  for (int i = 0; i < n; i++) {
+    eigenvectors[i * n + i] = 1.0;
+  }
+  
+  double scale = 0;
+  for (int i = 0; i < n * n; i++) {
+    scale += a[i] * a[i];
+  }
+  
+  for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+    double offDiagonal = 0;
+    for (int p = 0; p < n; p++) {
+      for (int q = p + 1; q < n; q++) {
+        offDiagonal += a[p * n + q] * a[p * n + q];
+      }
+    }
+    if (offDiagonal <= JACOBI_TOLERANCE * scale) {
+      break;
+    }
+    
+    for (int p = 0; p < n; p++) {
+      for (int q = p + 1; q < n; q++) {
+        double apq = a[p * n + q];
+        if (apq == 0) {
+          continue;
+        }
+        // The rotation that zeroes a_pq
+        double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+        double t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1));
+        double c = 1 / sqrt(t * t + 1);
+        double s = t * c;
+        
+        for (int k = 0; k < n; k++) { // columns p and q
+          double akp = a[k * n + p];
+          double akq = a[k * n + q];
+          a[k * n + p] = c * akp - s * akq;
+          a[k * n + q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < n; k++) { // rows p and q
+          double apk = a[p * n + k];
+          double aqk = a[q * n + k];
+          a[p * n + k] = c * apk - s * aqk;
+          a[q * n + k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < n; k++) {
+          double vkp = eigenvectors[k * n + p];
+          double vkq = eigenvectors[k * n + q];
+          eigenvectors[k * n + p] = c * vkp - s * vkq;
+          eigenvectors[k * n + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+  
+  eigenvalues.resize(n);
+  for (int i = 0; i < n; i++) {
+    eigenvalues[i] = a[i * n + i];
+  }
+}
+
+vector<double> nystromProjection(const vector<double> &landmarkKernel, int r, int &components) {
+  vector<double> eigenvalues;
+  vector<double> eigenvectors;
+  symmetricEigen(landmarkKernel, r, eigenvalues, eigenvectors);
+  
+  double largest = *max_element(eigenvalues.begin(), eigenvalues.end());
+  vector<double> projection;
+  components = 0;
+  for (int k = 0; k < r; k++) {
+    if (eigenvalues[k] <= EIGENVALUE_CUTOFF * largest) {
+      continue;
+    }
+    // Row of P: u_k^T / sqrt(lambda_k)
+    double scale = 1 / sqrt(eigenvalues[k]);
+    for (int l = 0; l < r; l++) {
+      projection.push_back(eigenvectors[l * r + k] * scale);
+    }
+    components++;
+  }
+  return projection;
+}
@@ -0,0 +1,62 @@
+//
+//  Nystrom.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef Nystrom_hpp
+#define Nystrom_hpp
+
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ How the landmark points of a Nystrom approximation are picked.
+ */
+enum LandmarkSelection {
+  // A uniform random sample of the training set
+  UNIFORM_LANDMARKS,
+  // k-means++ seeding: each landmark is drawn w/ probability proportional to
+  // its squared distance from the closest landmark picked so far
+  KMEANS_PLUS_PLUS_LANDMARKS
+};
+
+/**
+ Picks `count` distinct rows of `features` to use as landmarks.
+ 
+ @param features  the training features, one pointer per row
+ @param count     the number of landmarks (at most features.size())
+ @param selection how to pick them
+ @return the indices of the landmarks
+ */
+vector<int> selectLandmarks(const vector<const vector<int> *> &features, int count, LandmarkSelection selection);
+
+/**
+ Finds the eigenvalues and eigenvectors of the symmetric n x n row-major
+ matrix `a` w/ the cyclic Jacobi method.
+ 
+ @param a            the matrix
+ @param n            the size of the matrix
+ @param eigenvalues  the n eigenvalues
+ @param eigenvectors the eigenvectors, as the columns of an n x n row-major matrix
+ */
+void symmetricEigen(vector<double> a, int n, vector<double> &eigenvalues, vector<double> &eigenvectors);
+
+/**
+ Returns the Nystrom feature map P = L^(-1/2) U^T of the landmark kernel
+ matrix W = U L U^T, so that phi(x) = P k(x), where k(x) holds the kernel
+ values between x and each landmark, gives phi(u) . phi(v) ~ K(u, v).
+ Directions w/ tiny eigenvalues are dropped, since they make W singular.
+ 
+ @param landmarkKernel the r x r row-major kernel matrix of the landmarks
+ @param r              the number of landmarks
+ @param components     the number of rows of P (kept eigen-directions)
+ @return the components x r row-major matrix P
+ */
+vector<double> nystromProjection(const vector<double> &landmarkKernel, int r, int &components);
+
+#endif /* Nystrom_hpp */
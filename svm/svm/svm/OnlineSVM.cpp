@@ -0,0 +1,224 @@
+//
+//  OnlineSVM.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "OnlineSVM.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+// Stands in for a non-positive curvature K_ii + K_jj - 2 K_ij
+const double MIN_CURVATURE = 1e-12;
+
+OnlineSVM::OnlineSVM(double C, double tau, double cacheMegabytes) {
+  this->C = C;
+  this->tau = tau;
+  this->kernel = LINEAR_KERNEL;
+  this->gamma = 1.0;
+  this->coef0 = 1.0;
+  this->degree = 3;
+  this->b = 0.0;
+  this->delta = 0.0;
+  this->cacheMegabytes = cacheMegabytes;
+}
+
+void OnlineSVM::setKernel(KernelType kernel, double gamma, double coef0, int degree) {
+  assert(this->supportSet.empty());
+  this->kernel = kernel;
+  this->gamma = gamma;
+  this->coef0 = coef0;
+  this->degree = degree;
+}
+
+double OnlineSVM::kernelWith(int s, const vector<int> &x, double normX) {
+  return kernelValue(this->kernel, this->gamma, this->coef0, this->degree, dotProduct(this->slotFeatures[s], x), this->slotNorms[s], normX);
+}
+
+const float *OnlineSVM::kernelRow(int s) {
+  return (const float *)this->kernelCache->getRow(s);
+}
+
+int OnlineSVM::addToSupportSet(const vector<int> &x, int label) {
+  if (this->freeSlots.empty()) {
+    // Double the slots. The cached rows are too short for the new ones, so
+    // the cache starts over.
+    size_t oldSlots = this->slotFeatures.size();
+    size_t slots = max(INITIAL_ONLINE_SLOTS, 2 * oldSlots);
+    this->slotFeatures.resize(slots);
+    this->slotLabels.resize(slots, 0);
+    this->slotNorms.resize(slots, 0.0);
+    this->slotDiagonal.resize(slots, 0.0);
+    this->alphas.resize(slots, 0.0);
+    this->gradients.resize(slots, 0.0);
+    this->setPosition.resize(slots, -1);
+    for (size_t s = slots; s > oldSlots; s--) {
+      this->freeSlots.push_back((int)s - 1);
+    }
+    this->kernelCache = make_shared<KernelCache>(slots, slots * sizeof(float), this->cacheMegabytes, [this](int s, void *buffer) {
+      float *row = (float *)buffer;
+      for (int t : this->supportSet) {
+        row[t] = (float)this->kernelWith(s, this->slotFeatures[t], this->slotNorms[t]);
+      }
+    });
+  }
+  
+  int k = this->freeSlots.back();
+  this->freeSlots.pop_back();
+  this->slotFeatures[k] = x;
+  this->slotLabels[k] = label;
+  this->slotNorms[k] = dotProduct(x, x);
+  this->slotDiagonal[k] = this->kernelWith(k, x, this->slotNorms[k]);
+  this->alphas[k] = 0.0;
+  this->setPosition[k] = (int)this->supportSet.size();
+  this->supportSet.push_back(k);
+  
+  // Row k holds the new column of every other row, since K is symmetric
+  this->kernelCache->invalidate(k);
+  const float *K_k = this->kernelRow(k);
+  this->kernelCache->updateRows([K_k, k](int s, void *row) {
+    ((float *)row)[k] = K_k[s];
+  });
+  return k;
+}
+
+void OnlineSVM::removeFromSupportSet(int s) {
+  int position = this->setPosition[s];
+  int last = this->supportSet.back();
+  this->supportSet[position] = last;
+  this->setPosition[last] = position;
+  this->supportSet.pop_back();
+  this->setPosition[s] = -1;
+  this->alphas[s] = 0.0;
+  vector<int>().swap(this->slotFeatures[s]);
+  this->kernelCache->invalidate(s);
+  this->freeSlots.push_back(s);
+}
+
+void OnlineSVM::findViolatingPair(int &i, int &j) {
+  i = -1;
+  j = -1;
+  for (int s : this->supportSet) {
+    // alpha_s y_s is in [0, C]
+    double upper = max(0.0, this->C * this->slotLabels[s]);
+    double lower = min(0.0, this->C * this->slotLabels[s]);
+    if (this->alphas[s] < upper && (i < 0 || this->gradients[s] > this->gradients[i])) {
+      i = s;
+    }
+    if (this->alphas[s] > lower && (j < 0 || this->gradients[s] < this->gradients[j])) {
+      j = s;
+    }
+  }
+}
+
+bool OnlineSVM::optimizePair(int i, int j) {
+  if (i < 0 || j < 0 || this->gradients[i] - this->gradients[j] <= this->tau) {
+    return false;
+  }
+  const float *K_i = this->kernelRow(i);
+  const float *K_j = this->kernelRow(j);
+  double curvature = this->slotDiagonal[i] + this->slotDiagonal[j] - 2.0 * K_i[j];
+  if (curvature <= 0) {
+    curvature = MIN_CURVATURE;
+  }
+  double step = (this->gradients[i] - this->gradients[j]) / curvature;
+  step = min(step, max(0.0, this->C * this->slotLabels[i]) - this->alphas[i]);
+  step = min(step, this->alphas[j] - min(0.0, this->C * this->slotLabels[j]));
+  this->alphas[i] += step;
+  this->alphas[j] -= step;
+  for (int s : this->supportSet) {
+    this->gradients[s] -= step * (K_i[s] - K_j[s]);
+  }
+  return true;
+}
+
+void OnlineSVM::processExample(const vector<int> &x, int label) {
+  int k = this->addToSupportSet(x, label);
+  
+  // g_k = y_k - sum of alpha_s K(x_s, x_k)
+  const float *K_k = this->kernelRow(k);
+  double gradient = label;
+  for (int s : this->supportSet) {
+    gradient -= this->alphas[s] * K_k[s];
+  }
+  this->gradients[k] = gradient;
+  
+  // Pair the example w/ the most violating support vector on the other side
+  int i, j;
+  this->findViolatingPair(i, j);
+  if (label > 0) {
+    i = k;
+  } else {
+    j = k;
+  }
+  this->optimizePair(i, j);
+}
+
+void OnlineSVM::reprocess() {
+  int i, j;
+  this->findViolatingPair(i, j);
+  this->optimizePair(i, j);
+  
+  this->findViolatingPair(i, j);
+  if (i < 0 || j < 0) {
+    this->delta = 0.0;
+    return;
+  }
+  double gradientMax = this->gradients[i];
+  double gradientMin = this->gradients[j];
+  
+  // A support vector at 0 whose gradient is past the most violating pair
+  // would only be pushed further into the bound
+  for (int p = (int)this->supportSet.size() - 1; p >= 0; p--) {
+    int s = this->supportSet[p];
+    if (this->alphas[s] != 0) {
+      continue;
+    }
+    if ((this->slotLabels[s] < 0 && this->gradients[s] >= gradientMax) || (this->slotLabels[s] > 0 && this->gradients[s] <= gradientMin)) {
+      this->removeFromSupportSet(s);
+    }
+  }
+  
+  this->b = (gradientMax + gradientMin) / 2.0;
+  this->delta = gradientMax - gradientMin;
+}
+
+void OnlineSVM::process(const vector<int> &x, int label) {
+  assert(label == 1 || label == -1);
+  this->processExample(x, label);
+  this->reprocess();
+}
+
+void OnlineSVM::finish() {
+  do {
+    this->reprocess();
+  } while (this->delta > this->tau);
+}
+
+double OnlineSVM::predict(const vector<int> &x) {
+  double normX = dotProduct(x, x);
+  double f = this->b;
+  for (int s : this->supportSet) {
+    f += this->alphas[s] * this->kernelWith(s, x, normX);
+  }
+  return f;
+}
+
+int OnlineSVM::predictClass(const vector<int> &x) {
+  return (this->predict(x) >= 0) ? 1 : -1;
+}
+
+size_t OnlineSVM::getSupportVectorCount() {
+  return this->supportSet.size();
+}
+
+double OnlineSVM::getBias() {
+  return this->b;
+}
+
+double OnlineSVM::getDelta() {
+  return this->delta;
+}
@@ -0,0 +1,215 @@
+//
+//  OnlineSVM.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef OnlineSVM_hpp
+#define OnlineSVM_hpp
+
+#include "KernelCache.hpp"
+#include "SimpSVM.hpp"
+#include <memory>
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+// The number of support vector slots an `OnlineSVM` starts w/
+const size_t INITIAL_ONLINE_SLOTS = 1024;
+
+/**
+ A binary kernel SVM trained online, one example at a time, w/ the LASVM
+ algorithm (Bordes, Ertekin, Weston & Bottou, 2005).
+ 
+ Each example is added to the support set and paired w/ the most violating
+ support vector (PROCESS), then the most violating pair in the support set is
+ optimized and the support vectors that can't come back are dropped
+ (REPROCESS). Only the support vectors are kept, w/ a kernel row cache among
+ them that has a fixed memory budget, so memory is bounded by the number of
+ support vectors and an example costs O(#SV) kernel values and updates.
+ 
+ The model can be queried between any two examples.
+ */
+class OnlineSVM {
+private:
+  // Input parameters
+  double C; // regularization parameter
+  double tau; // the min gradient gap of a pair worth optimizing
+  KernelType kernel; // the kernel function
+  double gamma; // the kernel scale (polynomial and gaussian kernels)
+  double coef0; // the kernel offset (polynomial kernel)
+  int degree; // the kernel degree (polynomial kernel)
+  
+  // Support set, one slot per support vector. The alphas are signed, so
+  // alpha_s y_s >= 0, and the gradients are g_s = y_s - sum of alpha_t K_st.
+  vector<vector<int>> slotFeatures; // The features of each slot
+  vector<int> slotLabels; // The label of each slot
+  vector<double> slotNorms; // |x_s|^2 of each slot
+  vector<double> slotDiagonal; // K(x_s, x_s) of each slot
+  vector<double> alphas; // The signed alpha of each slot
+  vector<double> gradients; // The gradient of each slot
+  vector<int> supportSet; // The slots in use
+  vector<int> setPosition; // Where each slot is in `supportSet`, -1 if unused
+  vector<int> freeSlots; // The unused slots
+  double b; // The threshold
+  double delta; // The gradient gap of the most violating pair, 0 at the optimum
+  
+  // Kernel rows among the support vectors, indexed by slot
+  shared_ptr<KernelCache> kernelCache;
+  double cacheMegabytes; // The memory budget of `kernelCache`
+  
+  /**
+   Returns the kernel value between slot `s` and `x`.
+   
+   @param s     the slot
+   @param x     the feature vector
+   @param normX |x|^2
+   @return K(x_s, x)
+   */
+  double kernelWith(int s, const vector<int> &x, double normX);
+  
+  /**
+   Returns the kernel row of slot `s` over the support set. The rows of the
+   last 2 requests stay valid at once, like those of an SMO step.
+   
+   @param s the slot
+   @return K(x_s, x_t) at index t for every slot t in use
+   */
+  const float *kernelRow(int s);
+  
+  /**
+   Puts `x` in a free slot, doubling the slots (and starting a new kernel
+   cache) when there are none.
+   
+   @param x     the feature vector
+   @param label the label
+   @return the slot
+   */
+  int addToSupportSet(const vector<int> &x, int label);
+  
+  /**
+   Frees slot `s`.
+   
+   @param s the slot
+   */
+  void removeFromSupportSet(int s);
+  
+  /**
+   Finds the most violating pair: the max gradient over the slots whose alpha
+   can go up, and the min over those whose alpha can go down.
+   
+   @param i the slot w/ the max gradient, -1 if none
+   @param j the slot w/ the min gradient, -1 if none
+   */
+  void findViolatingPair(int &i, int &j);
+  
+  /**
+   Moves alpha_i up and alpha_j down as far as the bounds allow toward the
+   optimum of the pair, if their gradients differ by more than `tau`, and
+   updates the gradients of the support set.
+   
+   @param i the slot whose alpha goes up
+   @param j the slot whose alpha goes down
+   @return whether the pair was optimized
+   */
+  bool optimizePair(int i, int j);
+  
+  /**
+   The PROCESS step: adds the example to the support set and optimizes it
+   against the most violating support vector.
+   
+   @param x     the feature vector
+   @param label the label (+1 or -1)
+   */
+  void processExample(const vector<int> &x, int label);
+  
+  /**
+   The REPROCESS step: optimizes the most violating pair of the support set,
+   drops the support vectors at 0 that the pair shows can't come back, and
+   updates b and `delta`.
+   */
+  void reprocess();
+  
+public:
+  /**
+   Initializes an empty online SVM w/ the linear kernel.
+   
+   @param C              the regularization parameter
+   @param tau            the min gradient gap of a pair worth optimizing
+   @param cacheMegabytes the memory budget of the kernel row cache
+   */
+  OnlineSVM(double C, double tau = 0.001, double cacheMegabytes = DEFAULT_CACHE_MEGABYTES);
+  
+  // The kernel cache reads this model's slots, so it can't be copied
+  OnlineSVM(const OnlineSVM &) = delete;
+  OnlineSVM &operator=(const OnlineSVM &) = delete;
+  
+  /**
+   Switches to a non-linear kernel (the linear kernel is the default). Must
+   be called before the first example.
+   
+   @param kernel the kernel
+   @param gamma  the kernel scale
+   @param coef0  the kernel offset (polynomial only)
+   @param degree the kernel degree (polynomial only)
+   */
+  void setKernel(KernelType kernel, double gamma = 1.0, double coef0 = 1.0, int degree = 3);
+  
+  /**
+   Learns from one example: a PROCESS step on it and then a REPROCESS step.
+   
+   @param x     the feature vector
+   @param label the label (+1 or -1)
+   */
+  void process(const vector<int> &x, int label);
+  
+  /**
+   Runs REPROCESS steps until the support set is optimal within `tau`, e.g.
+   at the end of a stream or before a model is saved.
+   */
+  void finish();
+  
+  /**
+   Returns f(x) = sum of alpha_s K(x_s, x) + b for the current model.
+   
+   @param x the feature vector
+   @return the decision value
+   */
+  double predict(const vector<int> &x);
+  
+  /**
+   Predicts the class associated with feature vector `x` w/ the current
+   model.
+   
+   @param x the feature vector
+   @return the predicted class
+   */
+  int predictClass(const vector<int> &x);
+  
+  /**
+   Returns the number of support vectors in the current model.
+   
+   @return the number of support vectors
+   */
+  size_t getSupportVectorCount();
+  
+  /**
+   Returns the current threshold b.
+   
+   @return the threshold
+   */
+  double getBias();
+  
+  /**
+   Returns the gradient gap of the most violating pair after the last
+   REPROCESS step, 0 at the optimum.
+   
+   @return the gap
+   */
+  double getDelta();
+};
+
+#endif /* OnlineSVM_hpp */
@@ -0,0 +1,153 @@
+//
+//  SampleSelection.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "SampleSelection.hpp"
+#include "Nystrom.hpp"
+#include "SimpSVM.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <memory>
+#include <random>
+
+// The pre-model only ranks the samples, so it's trained loosely, and w/ a
+// small C so that it converges in a few epochs on overlapping classes
+const double PRE_MODEL_C = 0.01;
+const double PRE_MODEL_TOLERANCE = 0.1;
+// The part of each class's share taken from closest to the boundary. The rest
+// is uniform, which covers what a linear pre-model can't see and keeps the
+// worst violators (often label noise) from taking over the budget.
+const double BOUNDARY_FRACTION = 0.5;
+
+/**
+ Returns how far each sample is on the right side of the boundary between
+ its class and the closest other class, f_y(x) - max over c != y of f_c(x),
+ w/ one linear model f_c per class trained one-vs-rest.
+ */
+vector<double> linearMargins(const vector<vector<int>> &features, const vector<int> &labels, const vector<int> &classes) {
+  size_t m = labels.size();
+  size_t classCount = classes.size();
+  vector<double> scores(m * classCount);
+  
+  // The models all train on one copy of the features. Dual coordinate descent
+  // never reads the kernel cache, so it gets the smallest one.
+  BinSVM preModel(PRE_MODEL_C, PRE_MODEL_TOLERANCE, 1, DUAL_COORDINATE_DESCENT);
+  preModel.setVerbose(false);
+  SharedKernel store = preModel.shareKernel(make_shared<const vector<vector<int>>>(features), vector<size_t>(), 0);
+  vector<int> indices(m);
+  for (int i = 0; i < m; i++) {
+    indices[i] = i;
+  }
+  // W/ 2 classes, the 2nd model is the 1st one negated
+  size_t modelCount = (classCount == 2) ? 1 : classCount;
+  for (int c = 0; c < modelCount; c++) {
+    vector<int> oneVsRest(m);
+    for (int i = 0; i < m; i++) {
+      oneVsRest[i] = (labels[i] == classes[c]) ? 1 : -1;
+    }
+    BinSVM model = preModel;
+    model.train(store, indices, oneVsRest);
+    vector<double> w = model.getWeights();
+    for (int i = 0; i < m; i++) {
+      scores[i * classCount + c] = simdDot(w.data(), features[i].data(), w.size()) + model.getBias();
+      if (modelCount < classCount) {
+        scores[i * classCount + 1] = -scores[i * classCount];
+      }
+    }
+  }
+  
+  vector<double> margins(m);
+  for (int i = 0; i < m; i++) {
+    const double *score = scores.data() + i * classCount;
+    int own = (int)(lower_bound(classes.begin(), classes.end(), labels[i]) - classes.begin());
+    double rival = -INFINITY;
+    for (int c = 0; c < classCount; c++) {
+      if (c != own) {
+        rival = max(rival, score[c]);
+      }
+    }
+    margins[i] = score[own] - rival;
+  }
+  return margins;
+}
+
+vector<int> selectSamples(const vector<vector<int>> &features, const vector<int> &labels, size_t budget, SampleSelection method) {
+  assert(features.size() == labels.size());
+  size_t m = labels.size();
+  if (budget >= m) {
+    vector<int> all(m);
+    for (int i = 0; i < m; i++) {
+      all[i] = i;
+    }
+    return all;
+  }
+  
+  vector<int> classes = labels;
+  sort(classes.begin(), classes.end());
+  classes.erase(unique(classes.begin(), classes.end()), classes.end());
+  vector<vector<int>> members(classes.size());
+  for (int i = 0; i < m; i++) {
+    int c = (int)(lower_bound(classes.begin(), classes.end(), labels[i]) - classes.begin());
+    members[c].push_back(i);
+  }
+  
+  vector<double> margins;
+  if (method == MARGIN_SAMPLES) {
+    margins = linearMargins(features, labels, classes);
+  }
+  
+  // Largest remainder apportionment: each class gets the floor of its exact
+  // share, and the samples left over go to the largest fractional parts, so
+  // the shares add up to the budget. Since budget < m, no share can pass its
+  // class's size.
+  vector<size_t> shares(classes.size());
+  vector<int> byRemainder(classes.size());
+  size_t left = budget;
+  for (int c = 0; c < classes.size(); c++) {
+    shares[c] = members[c].size() * budget / m;
+    left -= shares[c];
+    byRemainder[c] = c;
+  }
+  stable_sort(byRemainder.begin(), byRemainder.end(), [&members, budget, m](int a, int b) {
+    return members[a].size() * budget % m > members[b].size() * budget % m;
+  });
+  for (int r = 0; r < left; r++) {
+    shares[byRemainder[r]]++;
+  }
+  
+  random_device seedGenerator;
+  mt19937_64 mersenneTwisterGenerator{seedGenerator()};
+  vector<int> selected;
+  for (int c = 0; c < classes.size(); c++) {
+    vector<int> &member = members[c];
+    int share = (int)shares[c];
+    if (share == 0) {
+      continue;
+    }
+    if (method == MARGIN_SAMPLES) {
+      // Closest to the boundary, on either side, first
+      int boundaryShare = (int)(share * BOUNDARY_FRACTION);
+      partial_sort(member.begin(), member.begin() + boundaryShare, member.end(), [&margins](int a, int b) {
+        return fabs(margins[a]) < fabs(margins[b]);
+      });
+      shuffle(member.begin() + boundaryShare, member.end(), mersenneTwisterGenerator);
+      selected.insert(selected.end(), member.begin(), member.begin() + share);
+    } else {
+      vector<const vector<int> *> rows(member.size());
+      for (int r = 0; r < member.size(); r++) {
+        rows[r] = &features[member[r]];
+      }
+      LandmarkSelection selection = (method == CLUSTER_SAMPLES) ? KMEANS_PLUS_PLUS_LANDMARKS : UNIFORM_LANDMARKS;
+      for (int r : selectLandmarks(rows, share, selection)) {
+        selected.push_back(member[r]);
+      }
+    }
+  }
+  sort(selected.begin(), selected.end());
+  return selected;
+}
@@ -0,0 +1,45 @@
+//
+//  SampleSelection.hpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#ifndef SampleSelection_hpp
+#define SampleSelection_hpp
+
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ How `selectSamples` picks the training samples to keep.
+ */
+enum SampleSelection {
+  // A uniform random sample
+  UNIFORM_SAMPLES,
+  // Half the samples closest to the decision boundary (on either side) of a
+  // cheap linear one-vs-rest pre-model, trained by dual coordinate descent,
+  // and half a uniform random sample of the rest
+  MARGIN_SAMPLES,
+  // Spread out representatives of each class, picked by k-means++ seeding
+  CLUSTER_SAMPLES
+};
+
+/**
+ Picks at most `budget` of the training samples to train a kernel SVM on,
+ favoring the informative ones over redundant ones. Each class keeps a share
+ of the budget proportional to its size, so the class balance is unchanged.
+ The shares are rounded by largest remainder, so they add up to the budget.
+ 
+ @param features the feature vectors
+ @param labels   the corresponding labels- any ints
+ @param budget   the max # of samples to keep
+ @param method   how to pick them
+ @return the indices of the kept samples, in increasing order
+ */
+vector<int> selectSamples(const vector<vector<int>> &features, const vector<int> &labels, size_t budget, SampleSelection method);
+
+#endif /* SampleSelection_hpp */
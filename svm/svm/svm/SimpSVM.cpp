@@ -7,18 +7,48 @@
 //
 
 #include "SimpSVM.hpp"
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <stdint.h>
 #include <random>
 #include <math.h>
 #include <iostream>
+#include <mutex>
+#include <string.h>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 // An alpha value has been updated, if it's deviation is at least this value.
 const double ALPHA_CHANGE_DEVIATION = 0.00000003;
 
-double dotProduct(vector<int> v1, vector<int> v2) {
+// Alphas within this fraction of C from a bound are rounding residue
+const double ALPHA_ROUNDING = 1e-12;
+
+// Stands in for a non-positive curvature (a_ij <= 0) in the working set solver
+const double TAU = 1e-12;
+
+// The working set solver shrinks the active set every this many iterations
+const int SHRINKING_INTERVAL = 1000;
+
+// The working set solvers report their progress every this many iterations
+const int PROGRESS_INTERVAL = 10000;
+
+// The fewest samples worth handing to a separate thread in an O(m) sweep
+const size_t MIN_SWEEP_CHUNK = 16384;
+
+// The max # of epochs of the coordinate descent solver
+const int MAX_EPOCHS = 1000;
+
+// Relative slack on the bound of a bounded prediction, so rounding in the
+// partial sum can't make it stop early w/ the wrong sign
+const double BOUND_SLACK = 1e-9;
+
+double dotProduct(const vector<int> &v1, const vector<int> &v2) {
   assert(v1.size() == v2.size());
   
-  double result = 0;
+  long result = 0;
   for (int i = 0; i < v1.size(); i++) {
     result += (v1[i] * v2[i]);
   }
@@ -26,6 +56,559 @@ double dotProduct(vector<int> v1, vector<int> v2) {
   return result;
 }
 
+double simdDot(const double *w, const int *x, size_t n) {
+  size_t i = 0;
+  double result = 0;
+#if defined(__AVX__)
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(x + i)));
+    __m256d x1 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(x + i + 4)));
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(w + i), x0));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(w + i + 4), x1));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m128i xi = _mm_loadu_si128((const __m128i *)(x + i));
+    __m128d x0 = _mm_cvtepi32_pd(xi);
+    __m128d x1 = _mm_cvtepi32_pd(_mm_shuffle_epi32(xi, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(w + i), x0));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(w + i + 2), x1));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1];
+#endif
+  for (; i < n; i++) {
+    result += w[i] * x[i];
+  }
+  return result;
+}
+
+double simdDot(const double *u, const double *v, size_t n) {
+  size_t i = 0;
+  double result = 0;
+#if defined(__AVX__)
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(u + i), _mm256_loadu_pd(v + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(u + i + 4), _mm256_loadu_pd(v + i + 4)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(u + i), _mm_loadu_pd(v + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(u + i + 2), _mm_loadu_pd(v + i + 2)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  result = lanes[0] + lanes[1];
+#endif
+  for (; i < n; i++) {
+    result += u[i] * v[i];
+  }
+  return result;
+}
+
+/**
+ The training features as a sparse row-major (CSR) matrix, so the coordinate
+ descent solver only touches the non-zero features of a row.
+ */
+struct SparseRows {
+  vector<size_t> rowStart; // Where each row starts in `columns` and `values`, w/ the end last
+  vector<int> columns; // The column of each non-zero value
+  vector<int> values; // The non-zero values
+  size_t dimension; // The number of columns
+  
+  SparseRows(const vector<const vector<int> *> &x) {
+    this->dimension = x.empty() ? 0 : x[0]->size();
+    this->rowStart.reserve(x.size() + 1);
+    this->rowStart.push_back(0);
+    for (int i = 0; i < x.size(); i++) {
+      const vector<int> &x_i = *x[i];
+      for (int k = 0; k < x_i.size(); k++) {
+        if (x_i[k] != 0) {
+          this->columns.push_back(k);
+          this->values.push_back(x_i[k]);
+        }
+      }
+      this->rowStart.push_back(this->columns.size());
+    }
+  }
+  
+  double dot(int i, const double *w) const {
+    double result = 0;
+    for (size_t n = this->rowStart[i]; n < this->rowStart[i + 1]; n++) {
+      result += w[this->columns[n]] * this->values[n];
+    }
+    return result;
+  }
+  
+  void add(int i, double scale, double *w) const {
+    for (size_t n = this->rowStart[i]; n < this->rowStart[i + 1]; n++) {
+      w[this->columns[n]] += scale * this->values[n];
+    }
+  }
+  
+  double squaredNorm(int i) const {
+    double result = 0;
+    for (size_t n = this->rowStart[i]; n < this->rowStart[i + 1]; n++) {
+      result += (double)this->values[n] * this->values[n];
+    }
+    return result;
+  }
+};
+
+/**
+ Dense real features stored contiguously, one row after another (e.g. the
+ Nystrom features).
+ */
+struct DenseRows {
+  const double *data; // The row-major matrix
+  size_t dimension; // The number of columns
+  
+  double dot(int i, const double *w) const {
+    return simdDot(this->data + i * this->dimension, w, this->dimension);
+  }
+  
+  void add(int i, double scale, double *w) const {
+    const double *row = this->data + i * this->dimension;
+    for (size_t k = 0; k < this->dimension; k++) {
+      w[k] += scale * row[k];
+    }
+  }
+  
+  double squaredNorm(int i) const {
+    const double *row = this->data + i * this->dimension;
+    return simdDot(row, row, this->dimension);
+  }
+};
+
+// The register tile of `blockedDots`: GEMM_MR rows by GEMM_NR columns
+const int GEMM_MR = 4;
+const int GEMM_NR = 8;
+
+// The cache blocks of `blockedDots`: GEMM_KC features of GEMM_MC rows stay in
+// L1/L2 while they're multiplied by the same features of GEMM_NC columns
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 64;
+const size_t GEMM_NC = 256;
+
+// The # of query rows `decisionValues` multiplies by the support vectors at once
+const size_t PREDICT_BLOCK_ROWS = 256;
+
+/**
+ Copies features [k0, k0 + kc) of `count` rows into `packed` as doubles, in
+ slabs of `tile` rows. Within a slab the values are feature-major, so the
+ micro-kernel reads both operands w/ unit stride. The last slab is padded
+ w/ 0 rows.
+ */
+void packRows(const int *const *rows, size_t count, size_t k0, size_t kc, int tile, double *packed) {
+  for (size_t s = 0; s < count; s += tile) {
+    double *slab = packed + s * kc;
+    for (int t = 0; t < tile; t++) {
+      if (s + t < count) {
+        const int *row = rows[s + t] + k0;
+        for (size_t k = 0; k < kc; k++) {
+          slab[k * tile + t] = row[k];
+        }
+      } else {
+        for (size_t k = 0; k < kc; k++) {
+          slab[k * tile + t] = 0;
+        }
+      }
+    }
+  }
+}
+
+/**
+ Multiplies a packed slab of GEMM_MR rows by a packed slab of GEMM_NR columns
+ over `kc` features, and adds the top left `mr` x `nr` of the product to
+ `out`, whose rows are `outStride` apart.
+ */
+void multiplyTile(size_t kc, const double *a, const double *b, double *out, size_t outStride, int mr, int nr) {
+  double tile[GEMM_MR * GEMM_NR];
+#if defined(__AVX__)
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  for (size_t k = 0; k < kc; k++) {
+    __m256d b0 = _mm256_loadu_pd(b + k * GEMM_NR);
+    __m256d b1 = _mm256_loadu_pd(b + k * GEMM_NR + 4);
+    __m256d a0 = _mm256_broadcast_sd(a + k * GEMM_MR);
+    c00 = _mm256_add_pd(c00, _mm256_mul_pd(a0, b0));
+    c01 = _mm256_add_pd(c01, _mm256_mul_pd(a0, b1));
+    __m256d a1 = _mm256_broadcast_sd(a + k * GEMM_MR + 1);
+    c10 = _mm256_add_pd(c10, _mm256_mul_pd(a1, b0));
+    c11 = _mm256_add_pd(c11, _mm256_mul_pd(a1, b1));
+    __m256d a2 = _mm256_broadcast_sd(a + k * GEMM_MR + 2);
+    c20 = _mm256_add_pd(c20, _mm256_mul_pd(a2, b0));
+    c21 = _mm256_add_pd(c21, _mm256_mul_pd(a2, b1));
+    __m256d a3 = _mm256_broadcast_sd(a + k * GEMM_MR + 3);
+    c30 = _mm256_add_pd(c30, _mm256_mul_pd(a3, b0));
+    c31 = _mm256_add_pd(c31, _mm256_mul_pd(a3, b1));
+  }
+  _mm256_storeu_pd(tile, c00);
+  _mm256_storeu_pd(tile + 4, c01);
+  _mm256_storeu_pd(tile + 8, c10);
+  _mm256_storeu_pd(tile + 12, c11);
+  _mm256_storeu_pd(tile + 16, c20);
+  _mm256_storeu_pd(tile + 20, c21);
+  _mm256_storeu_pd(tile + 24, c30);
+  _mm256_storeu_pd(tile + 28, c31);
+#elif defined(__SSE2__)
+  // One row of the tile at a time, in 4 registers
+  for (int r = 0; r < GEMM_MR; r++) {
+    __m128d c0 = _mm_setzero_pd();
+    __m128d c1 = _mm_setzero_pd();
+    __m128d c2 = _mm_setzero_pd();
+    __m128d c3 = _mm_setzero_pd();
+    for (size_t k = 0; k < kc; k++) {
+      __m128d ar = _mm_set1_pd(a[k * GEMM_MR + r]);
+      const double *bk = b + k * GEMM_NR;
+      c0 = _mm_add_pd(c0, _mm_mul_pd(ar, _mm_loadu_pd(bk)));
+      c1 = _mm_add_pd(c1, _mm_mul_pd(ar, _mm_loadu_pd(bk + 2)));
+      c2 = _mm_add_pd(c2, _mm_mul_pd(ar, _mm_loadu_pd(bk + 4)));
+      c3 = _mm_add_pd(c3, _mm_mul_pd(ar, _mm_loadu_pd(bk + 6)));
+    }
+    _mm_storeu_pd(tile + r * GEMM_NR, c0);
+    _mm_storeu_pd(tile + r * GEMM_NR + 2, c1);
+    _mm_storeu_pd(tile + r * GEMM_NR + 4, c2);
+    _mm_storeu_pd(tile + r * GEMM_NR + 6, c3);
+  }
+#else
+  fill(tile, tile + GEMM_MR * GEMM_NR, 0.0);
+  for (size_t k = 0; k < kc; k++) {
+    for (int r = 0; r < GEMM_MR; r++) {
+      for (int c = 0; c < GEMM_NR; c++) {
+        tile[r * GEMM_NR + c] += a[k * GEMM_MR + r] * b[k * GEMM_NR + c];
+      }
+    }
+  }
+#endif
+  for (int r = 0; r < mr; r++) {
+    for (int c = 0; c < nr; c++) {
+      out[r * outStride + c] += tile[r * GEMM_NR + c];
+    }
+  }
+}
+
+/**
+ Finds the dot product of every one of `rows` int rows `a` w/ every one of
+ `cols` int rows `b`, all `depth` long, as a cache-blocked matrix multiply
+ (A B^T). Blocks of both are packed as doubles so they're read w/ unit
+ stride, and a GEMM_MR x GEMM_NR tile of the product is built in registers.
+ 
+ @param a     the 1st rows
+ @param rows  the number of 1st rows
+ @param b     the 2nd rows
+ @param cols  the number of 2nd rows
+ @param depth the length of every row
+ @param out   the rows x cols dot products, row-major
+ */
+void blockedDots(const int *const *a, size_t rows, const int *const *b, size_t cols, size_t depth, double *out) {
+  fill(out, out + rows * cols, 0.0);
+  vector<double, AlignedAllocator<double>> packedA(GEMM_MC * GEMM_KC);
+  vector<double, AlignedAllocator<double>> packedB(GEMM_NC * GEMM_KC);
+  for (size_t jc = 0; jc < cols; jc += GEMM_NC) {
+    size_t nc = min(GEMM_NC, cols - jc);
+    for (size_t pc = 0; pc < depth; pc += GEMM_KC) {
+      size_t kc = min(GEMM_KC, depth - pc);
+      packRows(b + jc, nc, pc, kc, GEMM_NR, packedB.data());
+      for (size_t ic = 0; ic < rows; ic += GEMM_MC) {
+        size_t mc = min(GEMM_MC, rows - ic);
+        packRows(a + ic, mc, pc, kc, GEMM_MR, packedA.data());
+        for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+          for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+            multiplyTile(kc, packedA.data() + ir * kc, packedB.data() + jr * kc, out + (ic + ir) * cols + jc + jr, cols, (int)min((size_t)GEMM_MR, mc - ir), (int)min((size_t)GEMM_NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+#if defined(__AVX__)
+// Loads 4 kernel values as doubles
+inline __m256d loadFour(const int16_t *p) {
+  // Sign extend each 16 bit value by duplicating it into a 32 bit lane and
+  // shifting it back down (SSE2 only)
+  __m128i v = _mm_loadl_epi64((const __m128i *)p);
+  return _mm256_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+inline __m256d loadFour(const int32_t *p) {
+  return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)p));
+}
+
+inline __m256d loadFour(const float *p) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+#elif defined(__SSE2__)
+// Loads 2 kernel values as doubles
+inline __m128d loadTwo(const int16_t *p) {
+  int32_t pair;
+  memcpy(&pair, p, sizeof(pair));
+  __m128i v = _mm_cvtsi32_si128(pair);
+  return _mm_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+inline __m128d loadTwo(const int32_t *p) {
+  return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)p));
+}
+
+inline __m128d loadTwo(const float *p) {
+  return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double *)p)));
+}
+#endif
+
+/**
+ Adds deltaI * K_i[t] + deltaJ * K_j[t] to out[t] for t in [begin, end),
+ multiplied by signs[t] if `signs` isn't NULL, plus `offset`. This is the
+ O(m) update of the gradient (or error cache) after an SMO step.
+ 
+ @param out    the vector to update
+ @param signs  the labels as doubles, or NULL
+ @param K_i    the 1st kernel row
+ @param deltaI the multiplier of the 1st row
+ @param K_j    the 2nd kernel row
+ @param deltaJ the multiplier of the 2nd row
+ @param offset added to every element (w/o the sign)
+ @param begin  the 1st index to update
+ @param end    one past the last index to update
+ */
+template <typename T>
+void addKernelRows(double *out, const double *signs, const T *K_i, double deltaI, const T *K_j, double deltaJ, double offset, size_t begin, size_t end) {
+  size_t t = begin;
+#if defined(__AVX__)
+  __m256d dI = _mm256_set1_pd(deltaI);
+  __m256d dJ = _mm256_set1_pd(deltaJ);
+  __m256d off = _mm256_set1_pd(offset);
+  for (; t + 4 <= end; t += 4) {
+    __m256d sum = _mm256_add_pd(_mm256_mul_pd(dI, loadFour(K_i + t)), _mm256_mul_pd(dJ, loadFour(K_j + t)));
+    if (signs != NULL) {
+      sum = _mm256_mul_pd(sum, _mm256_loadu_pd(signs + t));
+    }
+    _mm256_storeu_pd(out + t, _mm256_add_pd(_mm256_loadu_pd(out + t), _mm256_add_pd(sum, off)));
+  }
+#elif defined(__SSE2__)
+  __m128d dI = _mm_set1_pd(deltaI);
+  __m128d dJ = _mm_set1_pd(deltaJ);
+  __m128d off = _mm_set1_pd(offset);
+  for (; t + 2 <= end; t += 2) {
+    __m128d sum = _mm_add_pd(_mm_mul_pd(dI, loadTwo(K_i + t)), _mm_mul_pd(dJ, loadTwo(K_j + t)));
+    if (signs != NULL) {
+      sum = _mm_mul_pd(sum, _mm_loadu_pd(signs + t));
+    }
+    _mm_storeu_pd(out + t, _mm_add_pd(_mm_loadu_pd(out + t), _mm_add_pd(sum, off)));
+  }
+#endif
+  for (; t < end; t++) {
+    double sum = deltaI * K_i[t] + deltaJ * K_j[t];
+    out[t] += ((signs != NULL) ? signs[t] * sum : sum) + offset;
+  }
+}
+
+/**
+ The partial result of a working set search over a range of samples. Ties
+ go to the larger index, as in a sequential scan w/ >= (or <=).
+ */
+struct WorkingSetScan {
+  double maxValue; // The max -y_t G_t over I_up, or y_t G_t over I_low
+  int maxIndex; // Where `maxValue` was found
+  double minObjective; // The min 2nd order objective over I_low
+  int objectiveIndex; // Where `minObjective` was found
+  
+  WorkingSetScan() {
+    this->maxValue = -INFINITY;
+    this->maxIndex = -1;
+    this->minObjective = INFINITY;
+    this->objectiveIndex = -1;
+  }
+  
+  void offerMax(double value, int index) {
+    if (value > this->maxValue || (value == this->maxValue && index > this->maxIndex)) {
+      this->maxValue = value;
+      this->maxIndex = index;
+    }
+  }
+  
+  void offerObjective(double objective, int index) {
+    if (objective < this->minObjective || (objective == this->minObjective && index > this->objectiveIndex)) {
+      this->minObjective = objective;
+      this->objectiveIndex = index;
+    }
+  }
+  
+  void merge(const WorkingSetScan &other) {
+    this->offerMax(other.maxValue, other.maxIndex);
+    this->offerObjective(other.minObjective, other.objectiveIndex);
+  }
+};
+
+/**
+ Finds max { -y_t G_t : t in I_up } for t in [begin, end).
+ 
+ @param signs    the labels as doubles
+ @param gradient the dual gradient
+ @param alphas   the multipliers
+ @param C        the upper bound of the multipliers
+ @param begin    the 1st sample
+ @param end      one past the last sample
+ @return the max and where it was found
+ */
+WorkingSetScan scanUpSet(const double *signs, const double *gradient, const double *alphas, double C, size_t begin, size_t end) {
+  WorkingSetScan scan;
+  size_t t = begin;
+#if defined(__AVX__)
+  // Each lane keeps its own max and index, merged at the end
+  __m256d zero = _mm256_setzero_pd();
+  __m256d upper = _mm256_set1_pd(C);
+  __m256d bestValue = _mm256_set1_pd(-INFINITY);
+  __m256d bestIndex = _mm256_set1_pd(-1);
+  __m256d index = _mm256_setr_pd(t, t + 1, t + 2, t + 3);
+  __m256d four = _mm256_set1_pd(4);
+  for (; t + 4 <= end; t += 4) {
+    __m256d y = _mm256_loadu_pd(signs + t);
+    __m256d alpha = _mm256_loadu_pd(alphas + t);
+    // I_up = { y_t = +1, a_t < C } U { y_t = -1, a_t > 0 }
+    __m256d up = _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(y, zero, _CMP_GT_OQ), _mm256_cmp_pd(alpha, upper, _CMP_LT_OQ)),
+                              _mm256_and_pd(_mm256_cmp_pd(y, zero, _CMP_LT_OQ), _mm256_cmp_pd(alpha, zero, _CMP_GT_OQ)));
+    __m256d value = _mm256_mul_pd(_mm256_sub_pd(zero, y), _mm256_loadu_pd(gradient + t));
+    __m256d take = _mm256_and_pd(up, _mm256_cmp_pd(value, bestValue, _CMP_GE_OQ));
+    bestValue = _mm256_blendv_pd(bestValue, value, take);
+    bestIndex = _mm256_blendv_pd(bestIndex, index, take);
+    index = _mm256_add_pd(index, four);
+  }
+  double values[4], indices[4];
+  _mm256_storeu_pd(values, bestValue);
+  _mm256_storeu_pd(indices, bestIndex);
+  for (int lane = 0; lane < 4; lane++) {
+    if (indices[lane] >= 0) {
+      scan.offerMax(values[lane], (int)indices[lane]);
+    }
+  }
+#endif
+  for (; t < end; t++) {
+    bool up = (signs[t] > 0) ? (alphas[t] < C) : (alphas[t] > 0);
+    if (up) {
+      scan.offerMax(-signs[t] * gradient[t], (int)t);
+    }
+  }
+  return scan;
+}
+
+/**
+ Finds max { y_t G_t : t in I_low } and, if `K_i` isn't NULL, the t in I_low
+ that minimizes the 2nd order objective -b_it^2 / a_it, for t in
+ [begin, end) (see `BinSVM::selectWorkingSet`).
+ 
+ @param signs    the labels as doubles
+ @param gradient the dual gradient
+ @param alphas   the multipliers
+ @param diagonal K(x_t, x_t) for each sample
+ @param C        the upper bound of the multipliers
+ @param K_i      row i of the kernel matrix, or NULL for first order
+ @param gMax     -y_i G_i
+ @param begin    the 1st sample
+ @param end      one past the last sample
+ @return the max, the min objective and where they were found
+ */
+template <typename T>
+WorkingSetScan scanLowSet(const double *signs, const double *gradient, const double *alphas, const double *diagonal, double C, const T *K_i, int i, double gMax, size_t begin, size_t end) {
+  WorkingSetScan scan;
+  double K_ii = (K_i != NULL) ? diagonal[i] : 0;
+  size_t t = begin;
+#if defined(__AVX__)
+  __m256d zero = _mm256_setzero_pd();
+  __m256d upper = _mm256_set1_pd(C);
+  __m256d tau = _mm256_set1_pd(TAU);
+  __m256d two = _mm256_set1_pd(2);
+  __m256d kii = _mm256_set1_pd(K_ii);
+  __m256d gmax = _mm256_set1_pd(gMax);
+  __m256d bestValue = _mm256_set1_pd(-INFINITY);
+  __m256d bestIndex = _mm256_set1_pd(-1);
+  __m256d bestObjective = _mm256_set1_pd(INFINITY);
+  __m256d objectiveIndex = _mm256_set1_pd(-1);
+  __m256d index = _mm256_setr_pd(t, t + 1, t + 2, t + 3);
+  __m256d four = _mm256_set1_pd(4);
+  for (; t + 4 <= end; t += 4) {
+    __m256d y = _mm256_loadu_pd(signs + t);
+    __m256d alpha = _mm256_loadu_pd(alphas + t);
+    // I_low = { y_t = +1, a_t > 0 } U { y_t = -1, a_t < C }
+    __m256d low = _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(y, zero, _CMP_GT_OQ), _mm256_cmp_pd(alpha, zero, _CMP_GT_OQ)),
+                               _mm256_and_pd(_mm256_cmp_pd(y, zero, _CMP_LT_OQ), _mm256_cmp_pd(alpha, upper, _CMP_LT_OQ)));
+    __m256d yG = _mm256_mul_pd(y, _mm256_loadu_pd(gradient + t));
+    __m256d take = _mm256_and_pd(low, _mm256_cmp_pd(yG, bestValue, _CMP_GE_OQ));
+    bestValue = _mm256_blendv_pd(bestValue, yG, take);
+    bestIndex = _mm256_blendv_pd(bestIndex, index, take);
+    if (K_i != NULL) {
+      __m256d gradDiff = _mm256_add_pd(gmax, yG);
+      __m256d quad = _mm256_sub_pd(_mm256_add_pd(kii, _mm256_loadu_pd(diagonal + t)), _mm256_mul_pd(two, loadFour(K_i + t)));
+      quad = _mm256_blendv_pd(tau, quad, _mm256_cmp_pd(quad, zero, _CMP_GT_OQ));
+      __m256d objective = _mm256_div_pd(_mm256_sub_pd(zero, _mm256_mul_pd(gradDiff, gradDiff)), quad);
+      __m256d better = _mm256_and_pd(_mm256_and_pd(low, _mm256_cmp_pd(gradDiff, zero, _CMP_GT_OQ)), _mm256_cmp_pd(objective, bestObjective, _CMP_LE_OQ));
+      bestObjective = _mm256_blendv_pd(bestObjective, objective, better);
+      objectiveIndex = _mm256_blendv_pd(objectiveIndex, index, better);
+    }
+    index = _mm256_add_pd(index, four);
+  }
+  double values[4], indices[4], objectives[4], objectiveIndices[4];
+  _mm256_storeu_pd(values, bestValue);
+  _mm256_storeu_pd(indices, bestIndex);
+  _mm256_storeu_pd(objectives, bestObjective);
+  _mm256_storeu_pd(objectiveIndices, objectiveIndex);
+  for (int lane = 0; lane < 4; lane++) {
+    if (indices[lane] >= 0) {
+      scan.offerMax(values[lane], (int)indices[lane]);
+    }
+    if (objectiveIndices[lane] >= 0) {
+      scan.offerObjective(objectives[lane], (int)objectiveIndices[lane]);
+    }
+  }
+#endif
+  for (; t < end; t++) {
+    bool low = (signs[t] > 0) ? (alphas[t] > 0) : (alphas[t] < C);
+    if (!low) {
+      continue;
+    }
+    double yG = signs[t] * gradient[t];
+    scan.offerMax(yG, (int)t);
+    if (K_i != NULL) {
+      double gradDiff = gMax + yG;
+      if (gradDiff > 0) {
+        double quad = K_ii + diagonal[t] - 2.0 * K_i[t];
+        scan.offerObjective(-(gradDiff * gradDiff) / ((quad > 0) ? quad : TAU), (int)t);
+      }
+    }
+  }
+  return scan;
+}
+
+double kernelValue(KernelType kernel, double gamma, double coef0, int degree, double dot, double normU, double normV) {
+  switch (kernel) {
+    case POLYNOMIAL_KERNEL:
+      return pow(gamma * dot + coef0, degree);
+    case GAUSSIAN_KERNEL:
+      // |u - v|^2 = |u|^2 + |v|^2 - 2 u . v
+      return exp(-gamma * max(0.0, normU + normV - 2 * dot));
+    default:
+      return dot;
+  }
+}
+
 int sign(double d) {
   if (d > 0) {
     return 1;
@@ -55,51 +638,559 @@ int sign(double d) {
 //  return result;
 //}
 
-BinSVM::BinSVM(double C, double tolerance, double maxPasses) {
+BinSVM::BinSVM(double C, double tolerance, double maxPasses, SMOSolver solver) {
   this->C = C; // 1
   this->tol = tolerance; // 0.001
   this->maxPasses = maxPasses;
+  this->solver = solver;
+  this->initialB = 0.0;
+  this->shrinking = true;
+  this->kernel = LINEAR_KERNEL;
+  this->gamma = 1.0;
+  this->coef0 = 1.0;
+  this->degree = 3;
+  this->boundedPrediction = false;
+  this->landmarkCount = 0;
+  this->landmarkSelection = KMEANS_PLUS_PLUS_LANDMARKS;
+  this->nystromComponents = 0;
+  this->cacheMegabytes = DEFAULT_CACHE_MEGABYTES;
+  this->cacheHits = 0;
+  this->cacheMisses = 0;
+  this->maxViolation = 0;
+  this->dualityGap = 0;
+  this->threads = 1;
+  this->verbose = true;
 }
 
 void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
   // Ensure size of feature and label vectors are the same
   assert(features.size() == labels.size());
-  size_t m = features.size();
+  this->featureStore = make_shared<const vector<vector<int>>>(move(features));
+  this->storeIndices.resize(labels.size());
+  for (int i = 0; i < labels.size(); i++) {
+    this->storeIndices[i] = i;
+  }
+  this->sharedKernel = SharedKernel();
+  vector<int>().swap(this->sharedRuns);
+  this->trainOnStore(labels);
+}
+
+void BinSVM::train(const SharedKernel &sharedKernel, const vector<int> &indices, const vector<int> &labels) {
+  assert(indices.size() == labels.size());
+  assert(is_sorted(indices.begin(), indices.end()));
+  this->featureStore = sharedKernel.features;
+  this->storeIndices = indices;
+  this->sharedKernel = sharedKernel;
   
-  // Initialize alphas and b to 0, save training labels
-  this->alphas.resize(m, 0.0);
+  // Since the indices are sorted, the samples in each block form a run
+  this->sharedRuns.clear();
+  const vector<size_t> &blockStart = sharedKernel.blockStart;
+  int block = 0;
+  for (int t = 0; t < indices.size(); t++) {
+    while (indices[t] >= blockStart[block + 1]) {
+      block++;
+    }
+    if (this->sharedRuns.empty() || this->sharedRuns[this->sharedRuns.size() - 3] != block) {
+      this->sharedRuns.push_back(block);
+      this->sharedRuns.push_back(t);
+      this->sharedRuns.push_back(t);
+    }
+    this->sharedRuns.back() = t + 1;
+  }
+  this->trainOnStore(labels);
+}
+
+void BinSVM::trainOnStore(const vector<int> &labels) {
+  size_t m = labels.size();
+  
+  // Initialize alphas and b to 0 (or the warm start), save training labels
+  this->alphas.assign(m, 0.0);
   this->b = 0.0;
+  if (!this->initialAlphas.empty()) {
+    copy(this->initialAlphas.begin(), this->initialAlphas.begin() + min(m, this->initialAlphas.size()), this->alphas.begin());
+    this->b = this->initialB;
+    vector<double>().swap(this->initialAlphas);
+  }
   this->y = labels;
-  this->x = features;
+  this->x.resize(m);
+  for (int i = 0; i < m; i++) {
+    this->x[i] = &(*this->featureStore)[this->storeIndices[i]];
+  }
+  this->repairFeasibility();
+  
+  // Forget the previous model
+  vector<double>().swap(this->w);
+  vector<int, AlignedAllocator<int>>().swap(this->supportVectors);
+  vector<double>().swap(this->svCoefficients);
+  vector<double>().swap(this->svSquaredNorms);
+  vector<double>().swap(this->svBoundSuffix);
+  
+  // Pick the element type: the narrowest int type that holds the linear
+  // kernel values exactly, since they're ints bounded by max |x_i|^2
+  // (Cauchy-Schwarz), or rounded floats otherwise.
+  this->squaredNorms.resize(m);
+  double maxSquaredNorm = 0;
+  for (int i = 0; i < m; i++) {
+    this->squaredNorms[i] = dotProduct(*this->x[i], *this->x[i]);
+    maxSquaredNorm = max(maxSquaredNorm, this->squaredNorms[i]);
+  }
+  bool approximate = this->kernel != LINEAR_KERNEL && this->landmarkCount > 0;
+  if (approximate) {
+    this->mapToLandmarks();
+  }
+  // Rows gathered from a shared matrix keep its element type
+  this->kernelStorage = this->sharedKernel.cache ? this->sharedKernel.storage : this->storageFor(maxSquaredNorm);
+  
+  if (this->solver == DUAL_COORDINATE_DESCENT) {
+    // Solves for w directly, w/o a kernel matrix
+    assert(this->kernel == LINEAR_KERNEL || approximate);
+    vector<double> weights;
+    if (approximate) {
+      DenseRows rows = {this->mappedFeatures.data(), (size_t)this->nystromComponents};
+      weights = this->trainCoordinateDescent(rows);
+    } else {
+      weights = this->trainCoordinateDescent(SparseRows(this->x));
+    }
+    this->b = weights.back();
+    weights.pop_back();
+    if (!approximate) {
+      this->w = weights;
+    }
+  } else {
+    switch (this->kernelStorage) {
+      case INT16_STORAGE:
+        this->optimize<int16_t>();
+        break;
+      case INT32_STORAGE:
+        this->optimize<int32_t>();
+        break;
+      default:
+        this->optimize<float>();
+        break;
+    }
+  }
+  
+  if (this->kernel == LINEAR_KERNEL) {
+    if (this->w.empty()) {
+      this->collapseToPrimal();
+    }
+  } else if (approximate) {
+    this->collapseToLandmarks();
+  } else {
+    this->compactSupportVectors();
+  }
+  this->releaseTrainingSet();
+}
+
+void BinSVM::repairFeasibility() {
+  double positiveSum = 0;
+  double negativeSum = 0;
+  for (int i = 0; i < this->alphas.size(); i++) {
+    this->alphas[i] = min(max(this->alphas[i], 0.0), this->C);
+    if (this->y[i] > 0) {
+      positiveSum += this->alphas[i];
+    } else {
+      negativeSum += this->alphas[i];
+    }
+  }
+  // Dual coordinate descent has no y^T alpha = 0 constraint
+  if (this->solver == DUAL_COORDINATE_DESCENT || positiveSum == negativeSum) {
+    return;
+  }
+  int largerClass = (positiveSum > negativeSum) ? 1 : -1;
+  double scale = min(positiveSum, negativeSum) / max(positiveSum, negativeSum);
+  for (int i = 0; i < this->alphas.size(); i++) {
+    if (this->y[i] == largerClass) {
+      this->alphas[i] *= scale;
+    }
+  }
+}
+
+KernelStorage BinSVM::storageFor(double maxSquaredNorm) {
+  if (this->kernel != LINEAR_KERNEL) {
+    return FLOAT_STORAGE;
+  } else if (maxSquaredNorm <= INT16_MAX) {
+    return INT16_STORAGE;
+  } else if (maxSquaredNorm <= INT32_MAX) {
+    return INT32_STORAGE;
+  }
+  return FLOAT_STORAGE;
+}
+
+vector<PathPoint> BinSVM::trainPath(vector<vector<int>> features, const vector<int> &labels, vector<double> cValues, double sharedCacheMegabytes) {
+  assert(features.size() == labels.size());
+  sort(cValues.begin(), cValues.end());
+  size_t m = labels.size();
+  SharedKernel shared = this->shareKernel(make_shared<const vector<vector<int>>>(move(features)), vector<size_t>(), sharedCacheMegabytes);
+  vector<int> indices(m);
+  for (int i = 0; i < m; i++) {
+    indices[i] = i;
+  }
+  
+  vector<PathPoint> path;
+  for (int k = 0; k < cValues.size(); k++) {
+    BinSVM model = *this;
+    model.C = cValues[k];
+    if (!path.empty()) {
+      // An alpha at the old C mostly stays at the bound, so it's moved to the
+      // new one. The warm start then rebalances y^T alpha = 0.
+      const BinSVM &previous = path.back().model;
+      vector<double> start = previous.alphas;
+      for (int i = 0; i < m; i++) {
+        if (start[i] == previous.C) {
+          start[i] = model.C;
+        }
+      }
+      model.setWarmStart(start, previous.b);
+    }
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    model.train(shared, indices, labels);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (this->verbose) {
+      cout << "C = " << model.C << ": " << seconds << " s" << endl;
+    }
+    path.push_back({model.C, model, seconds});
+  }
+  return path;
+}
+
+SharedKernel BinSVM::shareKernel(const shared_ptr<const vector<vector<int>>> &features, vector<size_t> blockStart, double megabytes) {
+  // The norms, kernel settings and store are captured by value, so the cache
+  // doesn't depend on this model staying alive
+  size_t m = features->size();
+  shared_ptr<vector<double>> norms = make_shared<vector<double>>(m);
+  double maxSquaredNorm = 0;
+  for (int i = 0; i < m; i++) {
+    (*norms)[i] = dotProduct((*features)[i], (*features)[i]);
+    maxSquaredNorm = max(maxSquaredNorm, (*norms)[i]);
+  }
+  if (blockStart.empty()) {
+    blockStart = {0, m};
+  }
+  assert(blockStart.front() == 0 && blockStart.back() == m);
+  size_t blocks = blockStart.size() - 1;
+  size_t maxBlockSize = 0;
+  for (int k = 0; k < blocks; k++) {
+    maxBlockSize = max(maxBlockSize, blockStart[k + 1] - blockStart[k]);
+  }
+  
+  SharedKernel shared;
+  shared.features = features;
+  shared.blockStart = blockStart;
+  shared.storage = this->storageFor(maxSquaredNorm);
+  KernelType kernel = this->kernel;
+  double gamma = this->gamma;
+  double coef0 = this->coef0;
+  int degree = this->degree;
+  KernelStorage storage = shared.storage;
+  size_t elementSize = (storage == INT16_STORAGE) ? sizeof(int16_t) : (storage == INT32_STORAGE) ? sizeof(int32_t) : sizeof(float);
+  shared.cache = make_shared<KernelCache>(m * blocks, maxBlockSize * elementSize, megabytes, [features, norms, blockStart, kernel, gamma, coef0, degree, storage](int entry, void *buffer) {
+    const vector<vector<int>> &x = *features;
+    size_t blocks = blockStart.size() - 1;
+    int i = (int)(entry / blocks);
+    size_t first = blockStart[entry % blocks];
+    size_t end = blockStart[entry % blocks + 1];
+    for (size_t t = first; t < end; t++) {
+      double value = kernelValue(kernel, gamma, coef0, degree, dotProduct(x[i], x[t]), (*norms)[i], (*norms)[t]);
+      switch (storage) {
+        case INT16_STORAGE:
+          ((int16_t *)buffer)[t - first] = (int16_t)value;
+          break;
+        case INT32_STORAGE:
+          ((int32_t *)buffer)[t - first] = (int32_t)value;
+          break;
+        default:
+          ((float *)buffer)[t - first] = (float)value;
+          break;
+      }
+    }
+  });
+  return shared;
+}
+
+double BinSVM::kernelFromDot(double dot, double normU, double normV) {
+  return kernelValue(this->kernel, this->gamma, this->coef0, this->degree, dot, normU, normV);
+}
+
+void BinSVM::collapseToPrimal() {
+  // For the linear kernel, f(x) = sum of alpha_i y_i (x_i . x) + b = w . x + b
+  size_t m = this->y.size();
+  size_t features = this->x[0]->size();
+  this->w.assign(features, 0.0);
+  for (int i = 0; i < m; i++) {
+    if (this->alphas[i] == 0) {
+      continue;
+    }
+    double coef = this->alphas[i] * this->y[i];
+    const vector<int> &x_i = *this->x[i];
+    for (int k = 0; k < features; k++) {
+      this->w[k] += coef * x_i[k];
+    }
+  }
+}
+
+void BinSVM::compactSupportVectors() {
+  // Only the samples w/ alpha > 0 contribute to f(x)
+  size_t m = this->y.size();
+  vector<int> indices;
+  vector<double> coefficients;
+  for (int i = 0; i < m; i++) {
+    if (this->alphas[i] > 0) {
+      indices.push_back(i);
+      coefficients.push_back(this->alphas[i] * this->y[i]);
+    }
+  }
+  this->packSupportVectors(indices, coefficients);
+}
+
+void BinSVM::packSupportVectors(const vector<int> &indices, const vector<double> &coefficients) {
+  assert(indices.size() == coefficients.size());
+  this->featureCount = this->x[0]->size();
+  this->svStride = alignedStride<int>(this->featureCount);
+  size_t svCount = indices.size();
+  
+  // Store the support vectors by decreasing |coefficient| * max K(x_i, .),
+  // so a bounded prediction sees the largest possible contributions first.
+  // For the polynomial kernel the max depends on |x|, so |x| = 1 is used to
+  // order them.
+  vector<int> order(svCount);
+  vector<double> priority(svCount);
+  for (int sv = 0; sv < svCount; sv++) {
+    order[sv] = sv;
+    priority[sv] = fabs(coefficients[sv]);
+    if (this->kernel == POLYNOMIAL_KERNEL) {
+      double norm = sqrt(dotProduct(*this->x[indices[sv]], *this->x[indices[sv]]));
+      priority[sv] *= pow(this->gamma * norm + fabs(this->coef0), this->degree);
+    }
+  }
+  stable_sort(order.begin(), order.end(), [&priority](int a, int b) { return priority[a] > priority[b]; });
+  
+  this->supportVectors.assign(svCount * this->svStride, 0);
+  this->svCoefficients.resize(svCount);
+  this->svSquaredNorms.resize(svCount);
+  for (int sv = 0; sv < svCount; sv++) {
+    const vector<int> &x_i = *this->x[indices[order[sv]]];
+    copy(x_i.begin(), x_i.end(), this->supportVectors.begin() + sv * this->svStride);
+    this->svCoefficients[sv] = coefficients[order[sv]];
+    this->svSquaredNorms[sv] = dotProduct(x_i, x_i);
+  }
+  
+  // Suffix sums for bounding the contribution of the remaining support
+  // vectors. Since |K(x_i, x)| <= 1 for the gaussian kernel and
+  // |K(x_i, x)| <= (gamma |x_i| |x| + |coef0|)^degree
+  //             = sum over k of C(degree, k) (gamma |x|)^k |coef0|^(degree - k) |x_i|^k
+  // for the polynomial kernel, row k holds sum over sv >= s of |coef| |x_sv|^k.
+  size_t terms = (this->kernel == POLYNOMIAL_KERNEL) ? this->degree + 1 : 1;
+  this->svBoundSuffix.assign(terms * (svCount + 1), 0.0);
+  for (int sv = (int)svCount - 1; sv >= 0; sv--) {
+    double norm = sqrt(this->svSquaredNorms[sv]);
+    double normPower = 1;
+    for (int k = 0; k < terms; k++) {
+      double *row = this->svBoundSuffix.data() + k * (svCount + 1);
+      row[sv] = row[sv + 1] + fabs(this->svCoefficients[sv]) * normPower;
+      normPower *= norm;
+    }
+  }
+}
+
+void BinSVM::mapToLandmarks() {
+  size_t m = this->y.size();
+  int r = min(this->landmarkCount, (int)m);
+  this->landmarks = selectLandmarks(this->x, r, this->landmarkSelection);
+  
+  // W_lk = K(x_l, x_k) over the landmarks
+  vector<double> landmarkKernel(r * r);
+  for (int l = 0; l < r; l++) {
+    for (int k = l; k < r; k++) {
+      int a = this->landmarks[l];
+      int c = this->landmarks[k];
+      landmarkKernel[l * r + k] = this->kernelFromDot(dotProduct(*this->x[a], *this->x[c]), this->squaredNorms[a], this->squaredNorms[c]);
+      landmarkKernel[k * r + l] = landmarkKernel[l * r + k];
+    }
+  }
+  this->nystromMap = nystromProjection(landmarkKernel, r, this->nystromComponents);
+  
+  // phi(x_i) = P k(x_i), so phi(u) . phi(v) = k(u)^T W^+ k(v) ~ K(u, v)
+  size_t components = this->nystromComponents;
+  this->mappedFeatures.assign(m * components, 0.0);
+  vector<double> landmarkRow(r);
+  for (int i = 0; i < m; i++) {
+    for (int l = 0; l < r; l++) {
+      int a = this->landmarks[l];
+      landmarkRow[l] = this->kernelFromDot(dotProduct(*this->x[i], *this->x[a]), this->squaredNorms[i], this->squaredNorms[a]);
+    }
+    double *phi = this->mappedFeatures.data() + i * components;
+    for (int k = 0; k < components; k++) {
+      phi[k] = simdDot(this->nystromMap.data() + k * r, landmarkRow.data(), r);
+    }
+  }
+  if (this->verbose) {
+    cout << "Mapped to " << components << " Nystrom features from " << r << " landmarks" << endl;
+  }
+}
+
+void BinSVM::collapseToLandmarks() {
+  // f(x) = w_phi . phi(x) + b, where w_phi = sum of alpha_i y_i phi(x_i).
+  // Since phi(x) = P k(x), f(x) = (P^T w_phi) . k(x) + b, so landmark l
+  // contributes c_l K(x_l, x) w/ c = P^T w_phi.
+  size_t m = this->y.size();
+  size_t components = this->nystromComponents;
+  int r = (int)this->landmarks.size();
+  vector<double> mappedWeights(components, 0.0);
+  for (int i = 0; i < m; i++) {
+    if (this->alphas[i] == 0) {
+      continue;
+    }
+    double coef = this->alphas[i] * this->y[i];
+    const double *phi = this->mappedFeatures.data() + i * components;
+    for (int k = 0; k < components; k++) {
+      mappedWeights[k] += coef * phi[k];
+    }
+  }
+  vector<double> coefficients(r, 0.0);
+  for (int k = 0; k < components; k++) {
+    const double *row = this->nystromMap.data() + k * r;
+    for (int l = 0; l < r; l++) {
+      coefficients[l] += row[l] * mappedWeights[k];
+    }
+  }
+  this->packSupportVectors(this->landmarks, coefficients);
+}
+
+void BinSVM::releaseTrainingSet() {
+  // Swapping w/ an empty vector frees the memory
+  vector<int>().swap(this->y);
+  vector<const vector<int> *>().swap(this->x);
+  vector<int>().swap(this->storeIndices);
+  this->featureStore.reset();
+  this->sharedKernel = SharedKernel();
+  vector<int>().swap(this->sharedRuns);
+  this->kernelCache.reset();
+  this->threadPool.reset();
+  vector<double>().swap(this->labelSigns);
+  vector<double>().swap(this->kernelDiagonal);
+  vector<double>().swap(this->squaredNorms);
+  vector<double>().swap(this->errors);
+  vector<double>().swap(this->gradient);
+  vector<double>().swap(this->gradientBar);
+  vector<int>().swap(this->activeSet);
+  vector<int>().swap(this->landmarks);
+  vector<double>().swap(this->nystromMap);
+  vector<double>().swap(this->mappedFeatures);
+}
+
+template <typename T>
+const T *BinSVM::kernelRow(int i) {
+  return (const T *)this->kernelCache->getRow(i);
+}
+
+template <typename T>
+void BinSVM::optimize() {
+  // Kernel rows are calculated on demand and kept in an LRU cache w/ a fixed
+  // memory budget. Since K is symmetric the solvers only ever read rows.
+  // With the Nystrom approximation, K(x_i, x_t) ~ phi(x_i) . phi(x_t).
+  size_t m = this->y.size();
+  size_t components = this->nystromComponents;
+  bool approximate = !this->mappedFeatures.empty();
+  this->kernelDiagonal.resize(m);
+  for (int i = 0; i < m; i++) {
+    if (approximate) {
+      const double *phi = this->mappedFeatures.data() + i * components;
+      this->kernelDiagonal[i] = simdDot(phi, phi, components);
+    } else {
+      this->kernelDiagonal[i] = this->kernelFromDot(this->squaredNorms[i], this->squaredNorms[i], this->squaredNorms[i]);
+    }
+  }
+  this->kernelCache = make_shared<KernelCache>(m, m * sizeof(T), this->cacheMegabytes, [this, m, components, approximate](int i, void *buffer) {
+    T *row = (T *)buffer;
+    if (approximate) {
+      const double *phi_i = this->mappedFeatures.data() + i * components;
+      this->parallelSweep(m, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+          row[t] = (T)simdDot(phi_i, this->mappedFeatures.data() + t * components, components);
+        }
+      });
+      return;
+    }
+    if (this->sharedKernel.cache) {
+      // Gather this model's columns from the blocks of the shared row they
+      // fall in
+      const int *columns = this->storeIndices.data();
+      size_t blocks = this->sharedKernel.blockStart.size() - 1;
+      for (int r = 0; r < this->sharedRuns.size(); r += 3) {
+        int block = this->sharedRuns[r];
+        int first = this->sharedRuns[r + 1];
+        int end = this->sharedRuns[r + 2];
+        int offset = (int)this->sharedKernel.blockStart[block];
+        this->sharedKernel.cache->readRow(columns[i] * (int)blocks + block, [row, columns, first, end, offset](const void *shared) {
+          const T *segment = (const T *)shared;
+          for (int t = first; t < end; t++) {
+            row[t] = segment[columns[t] - offset];
+          }
+        });
+      }
+      return;
+    }
+    const vector<int> &x_i = *this->x[i];
+    this->parallelSweep(m, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; t++) {
+        row[t] = (T)this->kernelFromDot(dotProduct(x_i, *this->x[t]), this->squaredNorms[i], this->squaredNorms[t]);
+      }
+    });
+  });
+  if (this->verbose) {
+    cout << "Caching up to " << this->kernelCache->getCapacity() << " of " << m << " kernel rows" << endl;
+  }
+  
+  // The O(m) sweeps of each iteration are split across threads once the
+  // training set is large enough for that to pay off
+  this->labelSigns.assign(this->y.begin(), this->y.end());
+  unsigned threadCount = (this->threads == 0) ? max(1u, thread::hardware_concurrency()) : this->threads;
+  if (threadCount > 1 && m >= 2 * MIN_SWEEP_CHUNK) {
+    this->threadPool = make_shared<ThreadPool>(threadCount - 1); // the calling thread takes a chunk too
+  }
+  
+  if (this->solver == SIMPLIFIED_SMO) {
+    this->trainSimplified<T>();
+  } else {
+    this->trainWorkingSet<T>();
+  }
+  
+  this->cacheHits = this->kernelCache->getHits();
+  this->cacheMisses = this->kernelCache->getMisses();
+  if (this->verbose) {
+    cout << "Kernel cache: " << this->cacheHits << " hits, " << this->cacheMisses << " misses" << endl;
+  }
+}
+
+template <typename T>
+void BinSVM::trainSimplified() {
+  size_t m = this->y.size();
+  const vector<int> &labels = this->y;
   
   // Set-up random number generator
   random_device seedGenerator;
   mt19937_64 mersenneTwisterGenerator{seedGenerator()};
   uniform_int_distribution<> inputDist{0, (int)m - 1};
   
-  // Calculate dot products between all features to speed up computation later
-  cout << "Pre-calculating linear kernel results..." << endl;
-  this->dp.resize(m, vector<long>(m , 0));
-  for (int i = 0; i < m; i++) {
-    for (int j = 0; j < m; j++) {
-      this->dp[i][j] = dotProduct(features[i], features[j]);
-    }
+  // Error cache: E_k = f(x^{(k)}) - y^{(k)} for every sample.
+  // With all alphas and b at 0, f(x) = 0 so E_k = -y^{(k)}. A warm start
+  // adds its b and the rows of its nonzero alphas.
+  this->errors.resize(m);
+  for (int k = 0; k < m; k++) {
+    this->errors[k] = this->b - labels[k];
   }
-  cout << "Pre-calculation complete!" << endl;
+  this->addAlphaRows<T>(this->errors.data(), NULL, false);
   
   int passesWithoutChangingAlphas = 0;
+  int pass = 0;
   while (passesWithoutChangingAlphas < this->maxPasses) {
     // Count of updates to alpha values in this pass
     int alphaUpdateCount = 0;
     
     for (int i = 0; i < m; i++) {
-      // Calculate E_i = f(x^{(i)}) - y^{(i)}
-      double fxi = 0;
-      for (int idx = 0; idx < m; idx++) {
-        fxi += this->alphas[idx] * labels[idx] * this->dp[idx][i];
-      }
-      fxi += this->b;
-      double E_i = fxi - labels[i];
+      // E_i = f(x^{(i)}) - y^{(i)} from the cache
+      double E_i = this->errors[i];
       
       if ((((labels[i] * E_i) < (-1 * this->tol)) && (alphas[i] < C)) || ((labels[i] * E_i > this->tol) && this->alphas[i] > 0)) {
         // Select a random j != i
@@ -107,13 +1198,8 @@ void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
         do {
           j = inputDist(mersenneTwisterGenerator);
         } while (j == i);
-        // Calculate E_j = f(x^{(j)}) - y^{(j)}
-        double fxj = 0;
-        for (int idx = 0; idx < m; idx++) {
-          fxj += this->alphas[idx] * labels[idx] * this->dp[idx][j];
-        }
-        fxj += b;
-        double E_j = fxj - labels[j];
+        // E_j = f(x^{(j)}) - y^{(j)} from the cache
+        double E_j = this->errors[j];
         
         // Save old alphas
         double oldAlpha_i = this->alphas[i];
@@ -136,7 +1222,9 @@ void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
           continue;
         }
         
-        double eta = 2 * this->dp[i][j] - this->dp[i][i] - this->dp[j][j];
+        const T *dpI = this->kernelRow<T>(i);
+        const T *dpJ = this->kernelRow<T>(j);
+        double eta = 2.0 * dpI[j] - this->kernelDiagonal[i] - this->kernelDiagonal[j];
         if (eta >= 0) {
           continue;
         }
@@ -158,13 +1246,22 @@ void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
         
         // Find new alpha_i
         this->alphas[i] += labels[i] * labels[j] * (oldAlpha_j - this->alphas[j]);
+        // Snap rounding residue onto the bounds. Otherwise alpha_i can be left
+        // a hair above 0 (or below C), where it keeps failing the KKT check
+        // but can't move by ALPHA_CHANGE_DEVIATION
+        if (this->alphas[i] < ALPHA_ROUNDING * C) {
+          this->alphas[i] = 0;
+        } else if (this->alphas[i] > (1 - ALPHA_ROUNDING) * C) {
+          this->alphas[i] = C;
+        }
         
         // Compute b1 and b2
-        double b1 = b - E_i - labels[i] * (this->alphas[i] - oldAlpha_i) * this->dp[i][i] - labels[j] * (this->alphas[j] - oldAlpha_j) * this->dp[i][j];
-        double b2 = b - E_j - labels[i] * (this->alphas[i] - oldAlpha_i) * this->dp[i][j] - labels[j] * (this->alphas[j] - oldAlpha_j) * this->dp[j][j];
+        double b1 = b - E_i - labels[i] * (this->alphas[i] - oldAlpha_i) * dpI[i] - labels[j] * (this->alphas[j] - oldAlpha_j) * dpI[j];
+        double b2 = b - E_j - labels[i] * (this->alphas[i] - oldAlpha_i) * dpI[j] - labels[j] * (this->alphas[j] - oldAlpha_j) * dpJ[j];
         
         // Compute b
         // Note: if both conditions hold, the values will both be equal
+        double oldB = this->b;
         if (0 < this->alphas[i] && this->alphas[i] < C) {
           this->b = b1;
         } else if (0 < this->alphas[j] && this->alphas[j] < C) {
@@ -172,6 +1269,16 @@ void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
         } else {
           this->b = (b1 + b2) / 2.0;
         }
+        
+        // Update the error cache- only alpha_i, alpha_j and b changed, so
+        // E_k moves by y_i * dAlpha_i * K_ik + y_j * dAlpha_j * K_jk + db.
+        // Rows i and j of the (symmetric) kernel matrix are read in order.
+        double deltaI = labels[i] * (this->alphas[i] - oldAlpha_i);
+        double deltaJ = labels[j] * (this->alphas[j] - oldAlpha_j);
+        double deltaB = this->b - oldB;
+        this->parallelSweep(m, [&](size_t begin, size_t end) {
+          addKernelRows(this->errors.data(), (const double *)NULL, dpI, deltaI, dpJ, deltaJ, deltaB, begin, end);
+        });
       }
     }
     if (alphaUpdateCount <= 0) {
@@ -179,20 +1286,737 @@ void BinSVM::train(vector<vector<int>> features, vector<int> labels) {
     } else {
       passesWithoutChangingAlphas = 0;
     }
+    
+    // Stop as soon as the KKT conditions hold within the tolerance, rather
+    // than waiting for `maxPasses` passes w/o a change. Each sample's check
+    // above allows |y_i E_i| to be off by `tol`, so a pair can be off by 2 tol.
+    pass++;
+    this->maxViolation = this->violationFromErrors();
+    if (this->verbose) {
+      cout << "Pass " << pass << ": " << alphaUpdateCount << " alphas changed, max KKT violation " << this->maxViolation << endl;
+    }
+    if (this->maxViolation < 2 * this->tol) {
+      break;
+    }
+  }
+  this->dualityGap = this->calculateDualityGap();
+  if (this->verbose) {
+    cout << "Optimization finished after " << pass << " passes, duality gap " << this->dualityGap << endl;
+  }
+}
+
+template <typename T>
+void BinSVM::trainWorkingSet() {
+  // This follows the decomposition method of Fan, Chen & Lin (2005), as used
+  // by LIBSVM, on the dual problem
+  //   min 1/2 a^T Q a - e^T a,  0 <= a_t <= C,  y^T a = 0
+  // where Q_ts = y_t y_s K(x_t, x_s). The gradient G = Q a - e is maintained
+  // so each iteration costs two kernel rows, and E_t = y_t G_t + b.
+  size_t m = this->y.size();
+  const vector<int> &labels = this->y;
+  
+  // With all alphas at 0, G_t = -1 and no alpha is at the upper bound.
+  // A warm start adds the rows of its nonzero alphas.
+  this->gradient.assign(m, -1.0);
+  this->gradientBar.assign(m, 0.0);
+  this->addAlphaRows<T>(this->gradient.data(), this->labelSigns.data(), false);
+  this->addAlphaRows<T>(this->gradientBar.data(), this->labelSigns.data(), true);
+  
+  // Every sample starts out active
+  this->activeSet.resize(m);
+  for (int t = 0; t < m; t++) {
+    this->activeSet[t] = t;
+  }
+  this->activeSize = m;
+  this->unshrunk = false;
+  int shrinkCountdown = (int)min(m, (size_t)SHRINKING_INTERVAL);
+  
+  long maxIterations = max((long)this->maxPasses * (long)m, 10000000L);
+  long iteration = 0;
+  for (; iteration < maxIterations; iteration++) {
+    // Periodically drop the bound alphas that are unlikely to change
+    if (--shrinkCountdown == 0) {
+      shrinkCountdown = (int)min(m, (size_t)SHRINKING_INTERVAL);
+      if (this->shrinking) {
+        this->shrink<T>();
+      }
+    }
+    
+    if (this->verbose && iteration % PROGRESS_INTERVAL == 0 && iteration > 0) {
+      cout << "Iteration " << iteration << ": max KKT violation " << this->maxViolation << ", " << this->activeSize << " active" << endl;
+    }
+    
+    // Select the working set (i, j), or stop if the KKT conditions hold
+    int i, j;
+    if (this->selectWorkingSet<T>(i, j)) {
+      // Optimal on the active set- check the whole training set before
+      // stopping, since a shrunk alpha may have become a violator
+      this->reconstructGradient<T>();
+      this->activeSize = m;
+      if (this->selectWorkingSet<T>(i, j)) {
+        break;
+      }
+      shrinkCountdown = 1; // shrink again on the next iteration
+    }
+    
+    const T *K_i = this->kernelRow<T>(i);
+    const T *K_j = this->kernelRow<T>(j);
+    double oldAlpha_i = this->alphas[i];
+    double oldAlpha_j = this->alphas[j];
+    bool wasUpperBound_i = this->alphas[i] >= this->C;
+    bool wasUpperBound_j = this->alphas[j] >= this->C;
+    
+    // Solve the two-variable sub-problem analytically, then clip it back
+    // into the box [0, C] along the line y_i a_i + y_j a_j = const
+    double quad = this->kernelDiagonal[i] + this->kernelDiagonal[j] - 2.0 * K_i[j];
+    if (quad <= 0) {
+      quad = TAU;
+    }
+    if (labels[i] != labels[j]) {
+      double delta = (-this->gradient[i] - this->gradient[j]) / quad;
+      double diff = this->alphas[i] - this->alphas[j];
+      this->alphas[i] += delta;
+      this->alphas[j] += delta;
+      if (diff > 0) {
+        if (this->alphas[j] < 0) {
+          this->alphas[j] = 0;
+          this->alphas[i] = diff;
+        }
+      } else {
+        if (this->alphas[i] < 0) {
+          this->alphas[i] = 0;
+          this->alphas[j] = -diff;
+        }
+      }
+      if (diff > 0) {
+        if (this->alphas[i] > C) {
+          this->alphas[i] = C;
+          this->alphas[j] = C - diff;
+        }
+      } else {
+        if (this->alphas[j] > C) {
+          this->alphas[j] = C;
+          this->alphas[i] = C + diff;
+        }
+      }
+    } else {
+      double delta = (this->gradient[i] - this->gradient[j]) / quad;
+      double sum = this->alphas[i] + this->alphas[j];
+      this->alphas[i] -= delta;
+      this->alphas[j] += delta;
+      if (sum > C) {
+        if (this->alphas[i] > C) {
+          this->alphas[i] = C;
+          this->alphas[j] = sum - C;
+        }
+      } else {
+        if (this->alphas[j] < 0) {
+          this->alphas[j] = 0;
+          this->alphas[i] = sum;
+        }
+      }
+      if (sum > C) {
+        if (this->alphas[j] > C) {
+          this->alphas[j] = C;
+          this->alphas[i] = sum - C;
+        }
+      } else {
+        if (this->alphas[i] < 0) {
+          this->alphas[i] = 0;
+          this->alphas[j] = sum;
+        }
+      }
+    }
+    
+    // Update the gradient of the active samples:
+    // G_t += Q_ti dAlpha_i + Q_tj dAlpha_j
+    double deltaI = labels[i] * (this->alphas[i] - oldAlpha_i);
+    double deltaJ = labels[j] * (this->alphas[j] - oldAlpha_j);
+    bool contiguous = this->activeSize == m;
+    this->parallelSweep(this->activeSize, [&](size_t begin, size_t end) {
+      if (contiguous) {
+        addKernelRows(this->gradient.data(), this->labelSigns.data(), K_i, deltaI, K_j, deltaJ, 0.0, begin, end);
+        return;
+      }
+      for (size_t a = begin; a < end; a++) {
+        int t = this->activeSet[a];
+        this->gradient[t] += labels[t] * (deltaI * K_i[t] + deltaJ * K_j[t]);
+      }
+    });
+    
+    // Keep G_bar (the gradient contribution of the alphas at C) up to date
+    // for all samples, so shrunk gradients can be rebuilt later
+    this->updateGradientBar<T>(i, wasUpperBound_i);
+    this->updateGradientBar<T>(j, wasUpperBound_j);
+  }
+  
+  // Rebuild the shrunk gradients in case the iteration cap was hit
+  this->reconstructGradient<T>();
+  this->activeSize = m;
+  this->b = this->calculateThreshold();
+  this->dualityGap = this->calculateDualityGap();
+  if (this->verbose) {
+    cout << "Optimization finished after " << iteration << " iterations, max KKT violation " << this->maxViolation << ", duality gap " << this->dualityGap << endl;
+  }
+}
+
+template <typename T>
+void BinSVM::addAlphaRows(double *out, const double *signs, bool upperBoundOnly) {
+  size_t m = this->y.size();
+  vector<int> nonzero;
+  for (int s = 0; s < m; s++) {
+    if (upperBoundOnly ? this->alphas[s] == this->C : this->alphas[s] > 0) {
+      nonzero.push_back(s);
+    }
+  }
+  if (this->verbose && !upperBoundOnly && !nonzero.empty()) {
+    cout << "Warm start from " << nonzero.size() << " nonzero alphas" << endl;
+  }
+  // Two rows per sweep, like an SMO step
+  for (int r = 0; r < nonzero.size(); r += 2) {
+    int i = nonzero[r];
+    int j = nonzero[min(r + 1, (int)nonzero.size() - 1)];
+    const T *K_i = this->kernelRow<T>(i);
+    const T *K_j = this->kernelRow<T>(j);
+    double coefI = this->alphas[i] * this->y[i];
+    double coefJ = (j != i) ? this->alphas[j] * this->y[j] : 0.0;
+    this->parallelSweep(m, [&](size_t begin, size_t end) {
+      addKernelRows(out, signs, K_i, coefI, K_j, coefJ, 0.0, begin, end);
+    });
+  }
+}
+
+template <typename Rows>
+vector<double> BinSVM::trainCoordinateDescent(const Rows &rows) {
+  // This follows Hsieh et al. (2008), as used by LIBLINEAR, on the dual
+  //   min 1/2 a^T Q a - e^T a,  0 <= a_i <= C
+  // where Q_ij = y_i y_j (x_i . x_j + 1). The bias is the weight of a
+  // constant feature of 1, which drops the y^T a = 0 constraint, so each
+  // alpha can be optimized on its own. Keeping w = sum of a_i y_i x_i makes
+  // the gradient G_i = y_i w . x_i - 1 cost one pass over row i.
+  size_t m = this->y.size();
+  size_t dimension = rows.dimension;
+  const vector<int> &labels = this->y;
+  vector<double> weights(dimension + 1, 0.0);
+  double &bias = weights[dimension];
+  // w of the starting alphas (0 unless warm started)
+  for (int i = 0; i < m; i++) {
+    if (this->alphas[i] > 0) {
+      rows.add(i, this->alphas[i] * labels[i], weights.data());
+      bias += this->alphas[i] * labels[i];
+    }
+  }
+  
+  vector<double> diagonal(m); // Q_ii
+  vector<int> order(m);
+  for (int i = 0; i < m; i++) {
+    diagonal[i] = rows.squaredNorm(i) + 1;
+    order[i] = i;
+  }
+  
+  random_device seedGenerator;
+  mt19937_64 mersenneTwisterGenerator{seedGenerator()};
+  
+  // The projected gradient range of the last epoch, used to shrink alphas
+  // stuck at a bound whose gradient keeps pushing them into it
+  double projectedMaxOld = INFINITY;
+  double projectedMinOld = -INFINITY;
+  int activeCount = (int)m;
+  
+  int epoch = 0;
+  while (epoch < MAX_EPOCHS) {
+    double projectedMax = -INFINITY;
+    double projectedMin = INFINITY;
+    
+    // Visit the active alphas in a random order
+    shuffle(order.begin(), order.begin() + activeCount, mersenneTwisterGenerator);
+    for (int s = 0; s < activeCount; s++) {
+      int i = order[s];
+      double G = labels[i] * (rows.dot(i, weights.data()) + bias) - 1;
+      
+      double projected = 0;
+      if (this->alphas[i] == 0) {
+        if (G > projectedMaxOld && this->shrinking) {
+          activeCount--;
+          swap(order[s], order[activeCount]);
+          s--;
+          continue;
+        } else if (G < 0) {
+          projected = G;
+        }
+      } else if (this->alphas[i] == this->C) {
+        if (G < projectedMinOld && this->shrinking) {
+          activeCount--;
+          swap(order[s], order[activeCount]);
+          s--;
+          continue;
+        } else if (G > 0) {
+          projected = G;
+        }
+      } else {
+        projected = G;
+      }
+      projectedMax = max(projectedMax, projected);
+      projectedMin = min(projectedMin, projected);
+      
+      if (fabs(projected) > TAU) {
+        double oldAlpha = this->alphas[i];
+        this->alphas[i] = min(max(oldAlpha - G / diagonal[i], 0.0), this->C);
+        double delta = (this->alphas[i] - oldAlpha) * labels[i];
+        rows.add(i, delta, weights.data());
+        bias += delta;
+      }
+    }
+    epoch++;
+    this->maxViolation = max(0.0, projectedMax - projectedMin);
+    
+    if (projectedMax - projectedMin <= this->tol) {
+      if (activeCount == m) {
+        break;
+      }
+      // Optimal on the active set- check every alpha before stopping
+      activeCount = (int)m;
+      projectedMaxOld = INFINITY;
+      projectedMinOld = -INFINITY;
+      continue;
+    }
+    projectedMaxOld = (projectedMax > 0) ? projectedMax : INFINITY;
+    projectedMinOld = (projectedMin < 0) ? projectedMin : -INFINITY;
+  }
+  
+  // With the bias folded into w, the gap is |w|^2 - sum of alpha_i + C * sum of hinge losses
+  double gap = simdDot(weights.data(), weights.data(), weights.size());
+  for (int i = 0; i < m; i++) {
+    gap += this->C * max(0.0, 1 - labels[i] * (rows.dot(i, weights.data()) + bias)) - this->alphas[i];
+  }
+  this->dualityGap = gap;
+  if (this->verbose) {
+    cout << "Optimization finished after " << epoch << " epochs, max KKT violation " << this->maxViolation << ", duality gap " << this->dualityGap << endl;
+  }
+  return weights;
+}
+
+template <typename T>
+void BinSVM::updateGradientBar(int i, bool wasUpperBound) {
+  bool isUpperBound = this->alphas[i] >= this->C;
+  if (wasUpperBound == isUpperBound) {
+    return;
+  }
+  size_t m = this->y.size();
+  const T *K_i = this->kernelRow<T>(i);
+  double coef = (isUpperBound ? this->C : -this->C) * this->y[i];
+  this->parallelSweep(m, [&](size_t begin, size_t end) {
+    addKernelRows(this->gradientBar.data(), this->labelSigns.data(), K_i, coef, K_i, 0.0, 0.0, begin, end);
+  });
+}
+
+template <typename T>
+void BinSVM::reconstructGradient() {
+  // G_t = G_bar_t - 1 + sum over the free alphas of Q_ts a_s
+  size_t m = this->y.size();
+  if (this->activeSize == m) {
+    return;
+  }
+  for (int a = this->activeSize; a < m; a++) {
+    int t = this->activeSet[a];
+    this->gradient[t] = this->gradientBar[t] - 1.0;
+  }
+  for (int s = 0; s < m; s++) {
+    if (this->alphas[s] <= 0 || this->alphas[s] >= this->C) {
+      continue;
+    }
+    const T *K_s = this->kernelRow<T>(s);
+    double coef = this->alphas[s] * this->y[s];
+    for (int a = this->activeSize; a < m; a++) {
+      int t = this->activeSet[a];
+      this->gradient[t] += coef * this->y[t] * K_s[t];
+    }
+  }
+}
+
+template <typename T>
+void BinSVM::shrink() {
+  // The maximal violations over the active set:
+  // upMax = max { -y_t G_t : t in I_up }, lowMax = max { y_t G_t : t in I_low }
+  double upMax = -INFINITY;
+  double lowMax = -INFINITY;
+  for (int a = 0; a < this->activeSize; a++) {
+    int t = this->activeSet[a];
+    double yG = this->y[t] * this->gradient[t];
+    if (this->inUpSet(t)) {
+      upMax = max(upMax, -yG);
+    }
+    if (this->inLowSet(t)) {
+      lowMax = max(lowMax, yG);
+    }
   }
-  cout << endl;
+  
+  // Close to the solution, restore everything once so an early bad shrink
+  // can't keep the solver from converging
+  if (!this->unshrunk && upMax + lowMax <= this->tol * 10) {
+    this->unshrunk = true;
+    this->reconstructGradient<T>();
+    this->activeSize = this->y.size();
+  }
+  
+  // Move the alphas stuck at a bound past the end of the active set
+  for (int a = 0; a < this->activeSize; a++) {
+    int t = this->activeSet[a];
+    if (this->canShrink(t, upMax, lowMax)) {
+      this->activeSize--;
+      swap(this->activeSet[a], this->activeSet[this->activeSize]);
+      a--;
+    }
+  }
+}
+
+bool BinSVM::canShrink(int t, double upMax, double lowMax) {
+  // A bound alpha can be shrunk if it can't form a violating pair w/ any
+  // other active alpha, i.e. the gradient pushes it further into its bound
+  bool up = this->inUpSet(t);
+  bool low = this->inLowSet(t);
+  double yG = this->y[t] * this->gradient[t];
+  if (low && !up) { // could only be picked as j
+    return yG < -upMax;
+  } else if (up && !low) { // could only be picked as i
+    return -yG < -lowMax;
+  }
+  return false; // free
 }
 
-double BinSVM::predict(vector<int> x) {
-  // Calculate f(x)
-  double fxi = 0;
-  for (int idx = 0; idx < this->alphas.size(); idx++) {
-    fxi += this->alphas[idx] * this->y[idx] * dotProduct(this->x[idx], x);
+template <typename T>
+bool BinSVM::selectWorkingSet(int &outI, int &outJ) {
+  // When nothing is shrunk the scans run vectorized over every sample,
+  // otherwise they gather through `activeSet`. Either way the active set is
+  // split into chunks across threads, whose partial results are merged. Ties
+  // go to the larger sample index.
+  bool contiguous = this->activeSize == this->y.size();
+  const double *signs = this->labelSigns.data();
+  mutex scanMutex;
+  
+  // i = argmax { -y_t G_t : t in I_up }
+  // I_up = { t : y_t = +1, a_t < C } U { t : y_t = -1, a_t > 0 }
+  WorkingSetScan up;
+  this->parallelSweep(this->activeSize, [&](size_t begin, size_t end) {
+    WorkingSetScan part;
+    if (contiguous) {
+      part = scanUpSet(signs, this->gradient.data(), this->alphas.data(), this->C, begin, end);
+    } else {
+      for (size_t a = begin; a < end; a++) {
+        int t = this->activeSet[a];
+        if (this->inUpSet(t)) {
+          part.offerMax(-signs[t] * this->gradient[t], t);
+        }
+      }
+    }
+    lock_guard<mutex> lock(scanMutex);
+    up.merge(part);
+  });
+  double gMax = up.maxValue;
+  int i = up.maxIndex;
+  
+  // j from I_low = { t : y_t = +1, a_t > 0 } U { t : y_t = -1, a_t < C }.
+  // First order: j = argmin { -y_t G_t }, the maximal violating pair.
+  // Second order: j = argmin of the objective decrease -b_it^2 / a_it over
+  // the t that violate w/ i, where b_it = -y_i G_i + y_t G_t and
+  // a_it = K_ii + K_tt - 2 K_it.
+  const T *K_i = (i >= 0 && this->solver == SECOND_ORDER_WSS) ? this->kernelRow<T>(i) : NULL;
+  WorkingSetScan low;
+  this->parallelSweep(this->activeSize, [&](size_t begin, size_t end) {
+    WorkingSetScan part;
+    if (contiguous) {
+      part = scanLowSet(signs, this->gradient.data(), this->alphas.data(), this->kernelDiagonal.data(), this->C, K_i, i, gMax, begin, end);
+    } else {
+      for (size_t a = begin; a < end; a++) {
+        int t = this->activeSet[a];
+        if (!this->inLowSet(t)) {
+          continue;
+        }
+        double yG = signs[t] * this->gradient[t];
+        part.offerMax(yG, t);
+        double gradDiff = gMax + yG;
+        if (K_i != NULL && gradDiff > 0) {
+          double quad = this->kernelDiagonal[i] + this->kernelDiagonal[t] - 2.0 * K_i[t];
+          part.offerObjective(-(gradDiff * gradDiff) / ((quad > 0) ? quad : TAU), t);
+        }
+      }
+    }
+    lock_guard<mutex> lock(scanMutex);
+    low.merge(part);
+  });
+  double gMax2 = low.maxValue;
+  int j = (this->solver == MAX_VIOLATING_PAIR) ? low.maxIndex : low.objectiveIndex;
+  
+  // Stop once the maximal violation m(a) - M(a) is within the tolerance
+  this->maxViolation = max(0.0, gMax + gMax2);
+  if (gMax + gMax2 < this->tol || i < 0 || j < 0) {
+    return true;
+  }
+  outI = i;
+  outJ = j;
+  return false;
+}
+
+template <typename Work>
+void BinSVM::parallelSweep(size_t count, const Work &work) {
+  if (this->threadPool && count >= 2 * MIN_SWEEP_CHUNK) {
+    this->threadPool->parallelFor(count, MIN_SWEEP_CHUNK, work);
+  } else {
+    work(0, count);
   }
-  fxi += this->b;
-  return fxi;
 }
 
-int BinSVM::predictClass(vector<int> x) {
+bool BinSVM::inUpSet(int t) {
+  return (this->y[t] == 1) ? (this->alphas[t] < this->C) : (this->alphas[t] > 0);
+}
+
+bool BinSVM::inLowSet(int t) {
+  return (this->y[t] == 1) ? (this->alphas[t] > 0) : (this->alphas[t] < this->C);
+}
+
+double BinSVM::violationFromErrors() {
+  double upMax = -INFINITY;
+  double lowMax = -INFINITY;
+  for (int t = 0; t < this->y.size(); t++) {
+    if (this->inUpSet(t)) {
+      upMax = max(upMax, -this->errors[t]);
+    }
+    if (this->inLowSet(t)) {
+      lowMax = max(lowMax, this->errors[t]);
+    }
+  }
+  return max(0.0, upMax + lowMax);
+}
+
+double BinSVM::calculateDualityGap() {
+  double gap = 0;
+  for (int t = 0; t < this->y.size(); t++) {
+    double r = (this->solver == SIMPLIFIED_SMO) ? this->y[t] * this->errors[t] : this->gradient[t] + this->y[t] * this->b;
+    gap += this->alphas[t] * r + this->C * max(0.0, -r);
+  }
+  return gap;
+}
+
+double BinSVM::calculateThreshold() {
+  // b = -rho, where rho averages y_t G_t over the free alphas. If every alpha
+  // is at a bound, rho is the midpoint of the feasible interval instead.
+  size_t m = this->y.size();
+  double upper = INFINITY;
+  double lower = -INFINITY;
+  double freeSum = 0;
+  int freeCount = 0;
+  for (int t = 0; t < m; t++) {
+    double yG = this->y[t] * this->gradient[t];
+    if (this->alphas[t] >= this->C) {
+      if (this->y[t] == -1) {
+        upper = min(upper, yG);
+      } else {
+        lower = max(lower, yG);
+      }
+    } else if (this->alphas[t] <= 0) {
+      if (this->y[t] == 1) {
+        upper = min(upper, yG);
+      } else {
+        lower = max(lower, yG);
+      }
+    } else {
+      freeCount++;
+      freeSum += yG;
+    }
+  }
+  double rho = (freeCount > 0) ? freeSum / freeCount : (upper + lower) / 2;
+  return -rho;
+}
+
+double BinSVM::predict(const vector<int> &x) {
+  if (this->kernel == LINEAR_KERNEL) {
+    // Calculate f(x) = w . x + b
+    assert(x.size() == this->w.size());
+    return simdDot(this->w.data(), x.data(), x.size()) + this->b;
+  }
+  
+  // Calculate f(x) = sum over the support vectors of alpha_i y_i K(x_i, x) + b
+  assert(x.size() == this->featureCount);
+  vector<double> query(x.begin(), x.end());
+  double queryNorm = simdDot(query.data(), x.data(), x.size());
+  double fx = this->b;
+  for (int sv = 0; sv < this->svCoefficients.size(); sv++) {
+    const int *row = this->supportVectors.data() + sv * this->svStride;
+    double dot = simdDot(query.data(), row, this->featureCount);
+    fx += this->svCoefficients[sv] * this->kernelFromDot(dot, this->svSquaredNorms[sv], queryNorm);
+  }
+  return fx;
+}
+
+int BinSVM::predictClass(const vector<int> &x) {
+  if (this->boundedPrediction && this->kernel != LINEAR_KERNEL) {
+    return this->predictClassBounded(x);
+  }
   return sign(this->predict(x));
 }
+
+int BinSVM::predictClassBounded(const vector<int> &x) {
+  assert(x.size() == this->featureCount);
+  vector<double> query(x.begin(), x.end());
+  double queryNorm = simdDot(query.data(), x.data(), x.size());
+  size_t svCount = this->svCoefficients.size();
+  
+  // The weight of each suffix sum row in the bound (see compactSupportVectors)
+  size_t terms = this->svBoundSuffix.size() / (svCount + 1);
+  vector<double> termWeights(terms, 1.0);
+  if (this->kernel == POLYNOMIAL_KERNEL) {
+    double scaledNorm = this->gamma * sqrt(queryNorm);
+    for (int k = 0; k < terms; k++) {
+      double binomial = 1;
+      for (int n = 0; n < k; n++) {
+        binomial = binomial * (this->degree - n) / (n + 1);
+      }
+      termWeights[k] = binomial * pow(scaledNorm, k) * pow(fabs(this->coef0), this->degree - k);
+    }
+  }
+  
+  double fx = this->b;
+  for (int sv = 0; sv < svCount; sv++) {
+    // Stop once the remaining support vectors can't flip the sign of f(x)
+    double remaining = 0;
+    for (int k = 0; k < terms; k++) {
+      remaining += termWeights[k] * this->svBoundSuffix[k * (svCount + 1) + sv];
+    }
+    if (fabs(fx) > remaining * (1 + BOUND_SLACK) + BOUND_SLACK) {
+      break;
+    }
+    
+    const int *row = this->supportVectors.data() + sv * this->svStride;
+    double dot = simdDot(query.data(), row, this->featureCount);
+    fx += this->svCoefficients[sv] * this->kernelFromDot(dot, this->svSquaredNorms[sv], queryNorm);
+  }
+  return sign(fx);
+}
+
+void BinSVM::decisionValues(const vector<vector<int>> &x, size_t begin, size_t end, double *values) {
+  if (this->kernel == LINEAR_KERNEL) {
+    for (size_t r = begin; r < end; r++) {
+      assert(x[r].size() == this->w.size());
+      values[r - begin] = simdDot(this->w.data(), x[r].data(), x[r].size()) + this->b;
+    }
+    return;
+  }
+  
+  size_t svCount = this->svCoefficients.size();
+  vector<const int *> svRows(svCount);
+  for (size_t sv = 0; sv < svCount; sv++) {
+    svRows[sv] = this->supportVectors.data() + sv * this->svStride;
+  }
+  vector<const int *> queryRows(PREDICT_BLOCK_ROWS);
+  vector<double> dots(PREDICT_BLOCK_ROWS * svCount);
+  for (size_t start = begin; start < end; start += PREDICT_BLOCK_ROWS) {
+    size_t count = min(PREDICT_BLOCK_ROWS, end - start);
+    for (size_t r = 0; r < count; r++) {
+      assert(x[start + r].size() == this->featureCount);
+      queryRows[r] = x[start + r].data();
+    }
+    blockedDots(queryRows.data(), count, svRows.data(), svCount, this->featureCount, dots.data());
+    
+    // f(x) = sum over the support vectors of alpha_i y_i K(x_i, x) + b
+    for (size_t r = 0; r < count; r++) {
+      double queryNorm = dotProduct(x[start + r], x[start + r]);
+      const double *row = dots.data() + r * svCount;
+      double fx = this->b;
+      for (size_t sv = 0; sv < svCount; sv++) {
+        fx += this->svCoefficients[sv] * this->kernelFromDot(row[sv], this->svSquaredNorms[sv], queryNorm);
+      }
+      values[start + r - begin] = fx;
+    }
+  }
+}
+
+vector<int> BinSVM::predictBatch(const vector<vector<int>> &x) {
+  size_t rows = x.size();
+  vector<double> values(rows);
+  auto scoreRows = [this, &x, &values](size_t begin, size_t end) {
+    this->decisionValues(x, begin, end, values.data() + begin);
+  };
+  unsigned threadCount = (this->threads == 0) ? max(1u, thread::hardware_concurrency()) : this->threads;
+  if (threadCount > 1 && rows >= 2 * PREDICT_BLOCK_ROWS) {
+    ThreadPool pool(threadCount - 1); // the calling thread takes a chunk too
+    pool.parallelFor(rows, PREDICT_BLOCK_ROWS, scoreRows);
+  } else {
+    scoreRows(0, rows);
+  }
+  
+  vector<int> predictions(rows);
+  for (size_t r = 0; r < rows; r++) {
+    predictions[r] = sign(values[r]);
+  }
+  return predictions;
+}
+
+void BinSVM::setKernel(KernelType kernel, double gamma, double coef0, int degree) {
+  this->kernel = kernel;
+  this->gamma = gamma;
+  this->coef0 = coef0;
+  this->degree = degree;
+}
+
+void BinSVM::setNystrom(int landmarks, LandmarkSelection selection) {
+  assert(landmarks >= 0);
+  this->landmarkCount = landmarks;
+  this->landmarkSelection = selection;
+}
+
+void BinSVM::setBoundedPrediction(bool boundedPrediction) {
+  this->boundedPrediction = boundedPrediction;
+}
+
+size_t BinSVM::getSupportVectorCount() {
+  return this->svCoefficients.size();
+}
+
+void BinSVM::setCacheSize(double megabytes) {
+  this->cacheMegabytes = megabytes;
+}
+
+size_t BinSVM::getCacheHits() {
+  return this->cacheHits;
+}
+
+size_t BinSVM::getCacheMisses() {
+  return this->cacheMisses;
+}
+
+vector<double> BinSVM::getWeights() {
+  return this->w;
+}
+
+void BinSVM::setVerbose(bool verbose) {
+  this->verbose = verbose;
+}
+
+void BinSVM::setThreads(unsigned threads) {
+  this->threads = threads;
+}
+
+double BinSVM::getMaxViolation() {
+  return this->maxViolation;
+}
+
+double BinSVM::getDualityGap() {
+  return this->dualityGap;
+}
+
+void BinSVM::setWarmStart(const vector<double> &alphas, double b) {
+  this->initialAlphas = alphas;
+  this->initialB = b;
+}
+
+vector<double> BinSVM::getAlphas() {
+  return this->alphas;
+}
+
+double BinSVM::getBias() {
+  return this->b;
+}
+
+void BinSVM::setShrinking(bool shrinking) {
+  this->shrinking = shrinking;
+}
@@ -9,6 +9,11 @@
 #ifndef SimpSVM_hpp
 #define SimpSVM_hpp
 
+#include "AlignedAllocator.hpp"
+#include "KernelCache.hpp"
+#include "Nystrom.hpp"
+#include "ThreadPool.hpp"
+#include <memory>
 #include <stdio.h>
 #include <string>
 #include <vector>
@@ -22,23 +27,407 @@ using namespace std;
  @param v2 the second vector
  @return the dot product
  */
-double dotProduct(vector<double> v1, vector<double> v2);
+double dotProduct(const vector<int> &v1, const vector<int> &v2);
+
+/**
+ Finds the dot product of a real vector `w` and an int vector `x` of length
+ `n`. Uses AVX or SSE2 when the compiler targets them.
+ 
+ @param w the real vector
+ @param x the int vector
+ @param n the length of both vectors
+ @return the dot product
+ */
+double simdDot(const double *w, const int *x, size_t n);
+
+/**
+ Finds the dot product of two real vectors `u` and `v` of length `n`. Uses
+ AVX or SSE2 when the compiler targets them.
+ 
+ @param u the 1st vector
+ @param v the 2nd vector
+ @param n the length of both vectors
+ @return the dot product
+ */
+double simdDot(const double *u, const double *v, size_t n);
+
+/**
+ The SMO variants `BinSVM` can train with.
+ */
+enum SMOSolver {
+  // Platt's simplified SMO: the 2nd multiplier is picked at random, and
+  // training stops after `maxPasses` passes w/o changing any alphas
+  SIMPLIFIED_SMO,
+  // Working set selection by the maximal violating pair (first order)
+  MAX_VIOLATING_PAIR,
+  // Working set selection using second order information (WSS3 from
+  // Fan, Chen & Lin 2005- the LIBSVM default)
+  SECOND_ORDER_WSS,
+  // Not SMO: dual coordinate descent on one alpha at a time, keeping w up to
+  // date (Hsieh et al. 2008- the LIBLINEAR default). Linear kernel or the
+  // Nystrom approximation only; the bias is learned as the weight of a
+  // constant feature of 1.
+  DUAL_COORDINATE_DESCENT
+};
+
+/**
+ The kernels `BinSVM` can use.
+ */
+enum KernelType {
+  // K(u, v) = u . v
+  LINEAR_KERNEL,
+  // K(u, v) = (gamma * u . v + coef0)^degree
+  POLYNOMIAL_KERNEL,
+  // K(u, v) = exp(-gamma * |u - v|^2)
+  GAUSSIAN_KERNEL
+};
+
+/**
+ Returns a kernel value from the dot product and squared norms of its two
+ arguments, which is all any of the kernels need.
+ 
+ @param kernel the kernel
+ @param gamma  the kernel scale
+ @param coef0  the kernel offset
+ @param degree the kernel degree
+ @param dot    u . v
+ @param normU  |u|^2
+ @param normV  |v|^2
+ @return K(u, v)
+ */
+double kernelValue(KernelType kernel, double gamma, double coef0, int degree, double dot, double normU, double normV);
+
+/**
+ The element types `BinSVM` can store its kernel matrix in. The int types hold
+ linear kernel values exactly, and the narrowest one that fits is picked
+ during training. Floats are the rounded fallback for the other kernels and
+ for linear kernel values past the int32 range.
+ */
+enum KernelStorage {
+  // 2-byte ints (linear kernel, max |x_i|^2 <= 32767, e.g. binarized digits)
+  INT16_STORAGE,
+  // 4-byte ints (linear kernel on larger int features)
+  INT32_STORAGE,
+  // 4-byte floats, rounded (non-linear kernels, or linear past the int32 range)
+  FLOAT_STORAGE
+};
+
+// The default memory budget of the kernel row cache
+const double DEFAULT_CACHE_MEGABYTES = 100;
+
+/**
+ A kernel matrix cache over a whole feature store, which several `BinSVM`s
+ training on subsets of the store (even at once, from different threads) can
+ share. See `BinSVM::shareKernel`.
+ 
+ The columns are split into blocks, and each row is cached one block at a
+ time, so a model only calculates the blocks its samples are in.
+ */
+struct SharedKernel {
+  shared_ptr<const vector<vector<int>>> features; // The feature store
+  vector<size_t> blockStart; // The 1st column of each block, w/ the # of columns last
+  shared_ptr<KernelCache> cache; // Entry i * blocks + k holds K(x_i, x_t) for the t in block k, read w/ `readRow`
+  KernelStorage storage; // The element type of the entries
+};
+
+struct PathPoint;
 
 class BinSVM {
 private:
   // Input parameters
   double C; // regularization parameter
-  double tol; // numerical tolerance
+  double tol; // numerical tolerance- for the working set solvers, the max KKT violation allowed at the solution
   int maxPasses; // max # of times to iterate over alphas w/o changing
+  SMOSolver solver; // the SMO variant used by `train`
+  KernelType kernel; // the kernel function
+  double gamma; // the kernel scale (polynomial and gaussian kernels)
+  double coef0; // the kernel offset (polynomial kernel)
+  int degree; // the kernel degree (polynomial kernel)
   
   // Solution
   vector<double> alphas; // A vector for holding the Lagrange multipliers for solution
   double b; // The threshold for solution
+  vector<double> initialAlphas; // The alphas the next training starts from, empty = all 0 (see `setWarmStart`)
+  double initialB; // The threshold the next training starts from
+  vector<double> w; // The primal weights, w = sum of alpha_i y_i x_i (linear kernel)
+  
+  // Support vectors (non-linear kernels)
+  size_t featureCount; // The length of a feature vector
+  size_t svStride; // The padded length of a row in `supportVectors`
+  vector<int, AlignedAllocator<int>> supportVectors; // The training features w/ alpha > 0, one aligned row each
+  vector<double> svCoefficients; // alpha_i y_i for each support vector
+  vector<double> svSquaredNorms; // |x_i|^2 for each support vector
+  vector<double> svBoundSuffix; // Suffix sums bounding the contribution of the remaining support vectors
+  bool boundedPrediction; // Whether `predictClass` stops once the sign of f(x) is known
+  
+  // Nystrom approximation (non-linear kernels)
+  int landmarkCount; // The number of landmarks, 0 = train on the exact kernel
+  LandmarkSelection landmarkSelection; // How the landmarks are picked
+  vector<int> landmarks; // The training sample indices of the landmarks
+  vector<double> nystromMap; // The components x landmarkCount feature map P = L^(-1/2) U^T
+  int nystromComponents; // The length of a mapped feature vector
+  vector<double> mappedFeatures; // phi(x_i) = P k(x_i) for each training sample, one row each
   
   // Caches
   vector<int> y; // A vector containing the training labels
-  vector<vector<int>> x; // A vector containing the training features
-  vector<vector<long>> dp; // The cached dot products between all features
+  shared_ptr<const vector<vector<int>>> featureStore; // The feature vectors the training set is taken from
+  vector<int> storeIndices; // Where each training sample is in `featureStore`
+  vector<const vector<int> *> x; // The training features, pointing into `featureStore`
+  SharedKernel sharedKernel; // The shared kernel matrix rows are gathered from, if any
+  vector<int> sharedRuns; // (block, 1st sample, end sample) of each run of training samples in one shared block
+  shared_ptr<KernelCache> kernelCache; // The most recently used kernel matrix rows during training
+  KernelStorage kernelStorage; // The element type of the cached kernel rows
+  double cacheMegabytes; // The memory budget of `kernelCache`
+  size_t cacheHits; // The kernel row requests served from the cache in the last training
+  size_t cacheMisses; // The kernel row requests calculated in the last training
+  vector<double> kernelDiagonal; // K(x_i, x_i) for each training sample
+  vector<double> squaredNorms; // |x_i|^2 for each training sample
+  vector<double> errors; // The error cache, E_k = f(x^{(k)}) - y^{(k)} during training
+  vector<double> gradient; // The dual gradient, G = Q alpha - 1, during working set training
+  vector<double> gradientBar; // G_bar_t = C * sum of Q_ts over the alphas at C- used to rebuild shrunk gradients
+  vector<int> activeSet; // The sample indices, w/ the active (unshrunk) ones first
+  int activeSize; // The number of active samples
+  bool shrinking; // Whether the working set solver shrinks the active set
+  bool unshrunk; // Whether the active set has been restored near the solution
+  double maxViolation; // The maximal KKT violation, max over I_up of -y G - min over I_low of -y G
+  double dualityGap; // The primal minus the dual objective at the end of the last training
+  unsigned threads; // The threads used for the O(m) sweeps of the SMO solvers (0 = one per core)
+  shared_ptr<ThreadPool> threadPool; // The workers for those sweeps, during training on a large enough set
+  vector<double> labelSigns; // The training labels as doubles, for the vectorized sweeps
+  bool verbose; // Whether training prints its progress
+  
+  /**
+   Trains on the samples `storeIndices` of `featureStore` w/ `labels`.
+   
+   @param labels the label of each training sample
+   */
+  void trainOnStore(const vector<int> &labels);
+  
+  /**
+   Returns the element type to store the kernel matrix in for features w/
+   squared norms up to `maxSquaredNorm`. Linear kernel values are ints
+   bounded by max |x_i|^2 (Cauchy-Schwarz), so they get the narrowest int
+   type that holds them exactly. Anything else is rounded to floats.
+   
+   @param maxSquaredNorm the max |x_i|^2
+   @return the element type
+   */
+  KernelStorage storageFor(double maxSquaredNorm);
+  
+  /**
+   Clips the starting alphas to [0, C] and, for the solvers w/ the
+   y^T alpha = 0 constraint, scales down the alphas of whichever class has
+   the larger sum until both sums match. Scaling keeps the shape of a warm
+   start solution, which stays close to the new one.
+   */
+  void repairFeasibility();
+  
+  /**
+   Folds the solution into the primal weight vector `w`. Only valid for the
+   linear kernel.
+   */
+  void collapseToPrimal();
+  
+  /**
+   Packs the training features w/ alpha > 0 and their coefficients into
+   `supportVectors` for prediction w/ a non-linear kernel.
+   */
+  void compactSupportVectors();
+  
+  /**
+   Packs the training features `indices` w/ the coefficients `coefficients`
+   into `supportVectors`, largest possible contribution first, and builds
+   the suffix sums used by bounded prediction.
+   
+   @param indices      the training sample indices to keep
+   @param coefficients the coefficient of each kept sample in f(x)
+   */
+  void packSupportVectors(const vector<int> &indices, const vector<double> &coefficients);
+  
+  /**
+   Picks the landmarks and maps every training sample to its Nystrom
+   features, so the solvers train a linear SVM on `mappedFeatures`.
+   */
+  void mapToLandmarks();
+  
+  /**
+   Folds the solution on the mapped features back into coefficients on the
+   landmarks, f(x) = sum of c_l K(x_l, x) + b, and packs the landmarks as
+   the support vectors.
+   */
+  void collapseToLandmarks();
+  
+  /**
+   Predicts the class of `x` by summing the support vector contributions in
+   order of their largest possible size, and stopping once the remaining ones
+   can no longer change the sign. Returns the same class as `predictClass`.
+   
+   @param x the feature vector
+   @return the predicted class
+   */
+  int predictClassBounded(const vector<int> &x);
+  
+  /**
+   Frees the training set, kernel matrix and solver state once the solution
+   has been folded into `w` or `supportVectors`.
+   */
+  void releaseTrainingSet();
+  
+  /**
+   Returns the kernel value from the dot product and squared norms of its
+   two arguments, which is all any of the kernels need.
+   
+   @param dot   u . v
+   @param normU |u|^2
+   @param normV |v|^2
+   @return K(u, v)
+   */
+  double kernelFromDot(double dot, double normU, double normV);
+  
+  /**
+   Returns row `i` of the kernel matrix, stored as `T`, from the cache.
+   
+   @param i the sample index
+   @return the kernel values K(x_i, x_t) for every t
+   */
+  template <typename T>
+  const T *kernelRow(int i);
+  
+  /**
+   Sets up the kernel row cache w/ elements of type `T` and runs the solver.
+   */
+  template <typename T>
+  void optimize();
+  
+  /**
+   Runs the simplified SMO algorithm on the cached training set.
+   */
+  template <typename T>
+  void trainSimplified();
+  
+  /**
+   Runs SMO w/ maximal violating pair or second order working set selection
+   on the cached training set.
+   */
+  template <typename T>
+  void trainWorkingSet();
+  
+  /**
+   Adds sum of alpha_s y_s K(x_s, x_t) over the nonzero alphas (or only those
+   at C) to `out[t]`, times `signs[t]` if `signs` isn't NULL. This builds the
+   starting gradient (or error cache) of a warm start, at a cost of one kernel
+   row per nonzero alpha.
+   
+   @param out            the vector to update
+   @param signs          the labels as doubles, or NULL
+   @param upperBoundOnly whether to sum only the alphas at C
+   */
+  template <typename T>
+  void addAlphaRows(double *out, const double *signs, bool upperBoundOnly);
+  
+  /**
+   Runs dual coordinate descent on the linear SVM over `rows`, keeping
+   w = sum of alpha_i y_i x_i up to date, so an epoch costs O(nonzeros) and
+   no kernel matrix is needed.
+   
+   @param rows the training features (see `SparseRows` and `DenseRows`)
+   @return the weights, w/ the bias (the weight of a constant 1) last
+   */
+  template <typename Rows>
+  vector<double> trainCoordinateDescent(const Rows &rows);
+  
+  /**
+   Runs `work(begin, end)` over chunks of [0, count), split across
+   `threadPool` when there is one and `count` is large enough.
+   
+   @param count the number of items
+   @param work  the function to run on each chunk
+   */
+  template <typename Work>
+  void parallelSweep(size_t count, const Work &work);
+  
+  /**
+   Picks the pair of multipliers to optimize next from the gradient.
+   
+   @param i the 1st index of the working set
+   @param j the 2nd index of the working set
+   @return true if the KKT conditions hold within `tol` (optimal)
+   */
+  template <typename T>
+  bool selectWorkingSet(int &i, int &j);
+  
+  /**
+   Rebuilds the gradient of the inactive (shrunk) samples.
+   */
+  template <typename T>
+  void reconstructGradient();
+  
+  /**
+   Removes the bound alphas that satisfy the KKT conditions by a margin from
+   the active set.
+   */
+  template <typename T>
+  void shrink();
+  
+  /**
+   Returns whether sample `t` may be removed from the active set.
+   
+   @param t      the sample index
+   @param upMax  max { -y_s G_s : s in I_up } over the active set
+   @param lowMax max { y_s G_s : s in I_low } over the active set
+   @return whether t may be shrunk
+   */
+  bool canShrink(int t, double upMax, double lowMax);
+  
+  /**
+   Updates G_bar after alpha_i moved on to or off of the upper bound C.
+   
+   @param i             the sample index
+   @param wasUpperBound whether alpha_i was at C before the update
+   */
+  template <typename T>
+  void updateGradientBar(int i, bool wasUpperBound);
+  
+  /**
+   Returns whether alpha_t can move up along y_t (t in I_up).
+   
+   @param t the sample index
+   @return whether t is in I_up
+   */
+  bool inUpSet(int t);
+  
+  /**
+   Returns whether alpha_t can move down along y_t (t in I_low).
+   
+   @param t the sample index
+   @return whether t is in I_low
+   */
+  bool inLowSet(int t);
+  
+  /**
+   Returns the maximal KKT violation of the simplified SMO solution from the
+   error cache. Since y_t G_t = E_t - b, the violation doesn't depend on b.
+   
+   @return the maximal KKT violation
+   */
+  double violationFromErrors();
+  
+  /**
+   Calculates the duality gap P(w, b) - D(alpha) of the current solution.
+   With r_t = y_t f(x_t) - 1 and y^T alpha = 0, it reduces to
+   sum of alpha_t r_t + C * sum of max(0, -r_t), so it only needs r_t, which
+   is y_t E_t for the simplified solver and G_t + y_t b for the others.
+   
+   @return the duality gap
+   */
+  double calculateDualityGap();
+  
+  /**
+   Calculates the threshold b from the gradient at the solution.
+   
+   @return the threshold
+   */
+  double calculateThreshold();
   
   /**
    Predicts the prediction without the sign operator applied.
@@ -47,7 +436,7 @@ private:
    @param x the feature vector
    @return the prediction
    */
-  double predict(vector<int> x);
+  double predict(const vector<int> &x);
   
 public:
   /**
@@ -56,8 +445,13 @@ public:
    @param C           the regularization parameter
    @param tolerance   the tolerance parameter
    @param maxPasses   the number of passes w/o changing alphas- terminating cond.
+                      for the simplified solver, which also stops once the
+                      maximal KKT violation is below 2 * `tolerance` (for the
+                      working set solvers, at most max(maxPasses * m, 10^7)
+                      iterations are run)
+   @param solver      the SMO variant to train with
    */
-  BinSVM(double C, double tolerance, double maxPasses);
+  BinSVM(double C, double tolerance, double maxPasses, SMOSolver solver = SECOND_ORDER_WSS);
   
   /**
    Trains the model on the feature vectors `features` and their corresponding
@@ -68,13 +462,236 @@ public:
    */
   void train(vector<vector<int>> features, vector<int> labels);
   
+  /**
+   Trains the model on the samples `indices` of a shared feature store,
+   gathering its kernel rows from the store's shared kernel matrix cache
+   rather than calculating them. Several models may train on the same
+   `sharedKernel` at once. The model's kernel settings must match those the
+   shared kernel was created w/.
+   
+   @param sharedKernel the feature store and its kernel matrix cache
+   @param indices      the rows of the store to train on, in increasing order
+   @param labels       the label of each of those rows
+   */
+  void train(const SharedKernel &sharedKernel, const vector<int> &indices, const vector<int> &labels);
+  
+  /**
+   Trains one model per value of C in `cValues` on the same training set,
+   w/ this model's other settings. The kernel matrix cache is created once
+   and shared by every solve, and the values are solved in increasing order,
+   each one warm started from the solution of the one before (see
+   `setWarmStart`). The alphas at the bound are scaled up to the new C, since
+   they mostly stay there.
+   
+   @param features             the feature vectors to train
+   @param labels               the corresponding labels
+   @param cValues              the values of C to train w/
+   @param sharedCacheMegabytes the memory budget of the shared kernel cache
+   @return a model and its training time for each C, in increasing order of C
+   */
+  vector<PathPoint> trainPath(vector<vector<int>> features, const vector<int> &labels, vector<double> cValues, double sharedCacheMegabytes = DEFAULT_CACHE_MEGABYTES);
+  
+  /**
+   Creates a thread-safe cache of the kernel matrix over all of `features`,
+   using this model's kernel, for models trained on subsets of `features`
+   to share. The columns are cached in the blocks `blockStart`, e.g. one per
+   class, so a model on a few blocks never calculates the others.
+   
+   @param features   the feature store
+   @param blockStart the 1st column of each block, w/ features->size() last
+                     (empty = a single block)
+   @param megabytes  the memory budget of the cache
+   @return the shared kernel
+   */
+  SharedKernel shareKernel(const shared_ptr<const vector<vector<int>>> &features, vector<size_t> blockStart, double megabytes);
+  
+  /**
+   Starts the next training from the alphas `alphas` and threshold `b`
+   (e.g. `getAlphas()` and `getBias()` of an earlier model) rather than from
+   all 0s. `alphas[i]` is the starting alpha of the i-th training sample, and
+   the samples past the end of `alphas` start at 0, so a model can be
+   retrained after samples are appended or C changes. The alphas are repaired
+   to be feasible before training. The solvers then only do the work of
+   moving from there to the new solution.
+   
+   @param alphas the starting alphas
+   @param b      the starting threshold (only used by the simplified solver;
+                 the others derive b from the alphas)
+   */
+  void setWarmStart(const vector<double> &alphas, double b);
+  
+  /**
+   Returns the alphas of the training samples after training, in training
+   order.
+   Note: This should be called only after training a model.
+   
+   @return the alphas
+   */
+  vector<double> getAlphas();
+  
   /**
    Predicts the class associated with feature vector `x`.
 
    @param x the feature vector
    @return the predicted class
    */
-  int predictClass(vector<int> x);
+  int predictClass(const vector<int> &x);
+  
+  /**
+   Calculates f(x) for the feature vectors `x[begin]` to `x[end - 1]` at
+   once, on the calling thread. W/ a non-linear kernel, the dot products of a
+   block of rows w/ all the support vectors are found by one cache-blocked
+   matrix multiply, and each row's kernel values are then summed w/ the
+   support vector coefficients.
+   Note: This should be called only after training a model.
+   
+   @param x      the feature vectors
+   @param begin  the first row
+   @param end    one past the last row
+   @param values f(x[r]) at index r - begin
+   */
+  void decisionValues(const vector<vector<int>> &x, size_t begin, size_t end, double *values);
+  
+  /**
+   Predicts the class of every feature vector in `x`, split across
+   `setThreads` threads. Returns the same classes as `predictClass`.
+   Note: This should be called only after training a model.
+   
+   @param x the feature vectors
+   @return the predicted class of each
+   */
+  vector<int> predictBatch(const vector<vector<int>> &x);
+  
+  /**
+     Switches to a non-linear kernel (the linear kernel is the default).
+   
+   @param kernel the kernel
+   @param gamma  the kernel scale
+   @param coef0  the kernel offset (polynomial only)
+   @param degree the kernel degree (polynomial only)
+   */
+  void setKernel(KernelType kernel, double gamma = 1.0, double coef0 = 1.0, int degree = 3);
+  
+  /**
+   Trains on a Nystrom approximation of the (non-linear) kernel instead of
+   the exact kernel matrix. `landmarks` training samples are picked and every
+   sample is mapped to the r-dimensional feature vector phi(x) = L^(-1/2) U^T k(x),
+   where U L U^T is the landmark kernel matrix and k(x) holds the kernel
+   values between x and each landmark. The SVM is then trained as a linear
+   problem on phi(x), and prediction costs `landmarks` kernel evaluations.
+   More landmarks give a closer approximation.
+   
+   @param landmarks the number of landmarks, 0 = use the exact kernel
+   @param selection how to pick the landmarks
+   */
+  void setNystrom(int landmarks, LandmarkSelection selection = KMEANS_PLUS_PLUS_LANDMARKS);
+  
+  /**
+   Turns bounded (early exit) prediction on or off for the non-linear
+   kernels. When on, `predictClass` stops evaluating kernels as soon as the
+   remaining support vectors can't flip the sign of f(x).
+   
+   @param boundedPrediction whether to stop early
+   */
+  void setBoundedPrediction(bool boundedPrediction);
+  
+  /**
+   Returns the number of support vectors kept for prediction, 0 for the
+   linear kernel, which only keeps `w`.
+   
+   @return the number of support vectors
+   */
+  size_t getSupportVectorCount();
+  
+  /**
+   Sets the memory budget of the kernel row cache used during training.
+   Training memory is O(budget) rather than O(m^2).
+   
+   @param megabytes the budget in megabytes
+   */
+  void setCacheSize(double megabytes);
+  
+  /**
+   Returns the number of kernel row requests served from the cache in the
+   last training.
+   
+   @return the hit count
+   */
+  size_t getCacheHits();
+  
+  /**
+   Returns the number of kernel row requests that had to be calculated in the
+   last training.
+   
+   @return the miss count
+   */
+  size_t getCacheMisses();
+  
+  /**
+   Returns the primal weights after training.
+   Note: This should be called only after training a model w/ the linear
+   kernel.
+   
+   @return the weights
+   */
+  vector<double> getWeights();
+  
+  /**
+   Turns the training progress output on or off (on by default).
+   
+   @param verbose whether to print the progress of training
+   */
+  void setVerbose(bool verbose);
+  
+  /**
+   Sets the number of threads the SMO solvers split their O(m) sweeps over:
+   the gradient (or error cache) update, the working set search and kernel
+   row calculation. Only training sets of at least 32768 samples are split.
+   
+   @param threads the number of threads (0 = one per core, 1 by default)
+   */
+  void setThreads(unsigned threads);
+  
+  /**
+   Returns the maximal KKT violation at the end of the last training. Below
+   `tolerance` means training converged.
+   
+   @return the maximal KKT violation
+   */
+  double getMaxViolation();
+  
+  /**
+   Returns the duality gap (primal minus dual objective) at the end of the
+   last training. It's 0 at the optimum.
+   
+   @return the duality gap
+   */
+  double getDualityGap();
+  
+  /**
+   Returns the threshold b after training.
+   Note: This should be called only after training a model.
+   
+   @return the threshold
+   */
+  double getBias();
+  
+  /**
+   Turns shrinking on or off for the working set solvers (on by default).
+   Shrinking periodically drops the alphas stuck at 0 or C from the active set.
+   
+   @param shrinking whether to shrink
+   */
+  void setShrinking(bool shrinking);
+};
+
+/**
+ One point of a regularization path (see `BinSVM::trainPath`).
+ */
+struct PathPoint {
+  double C; // The regularization parameter
+  BinSVM model; // The model trained w/ C
+  double seconds; // The time it took to train `model`, including its warm start
 };
 
 
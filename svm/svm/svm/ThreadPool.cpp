@@ -0,0 +1,101 @@
+//
+//  ThreadPool.cpp
+//  svm
+//
+//  Created by Brian Desnoyers on 2/18/17.
+//  Copyright © 2017 Brian Desnoyers. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  this->pendingTasks = 0;
+  this->stopping = false;
+  for (unsigned i = 0; i < threads; i++) {
+    this->workers.push_back(thread(&ThreadPool::workerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> lock(this->queueMutex);
+    this->stopping = true;
+  }
+  this->taskAvailable.notify_all();
+  for (int i = 0; i < this->workers.size(); i++) {
+    this->workers[i].join();
+  }
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock(this->queueMutex);
+      this->taskAvailable.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+      if (this->tasks.empty()) { // stopping w/ nothing left to do
+        return;
+      }
+      task = move(this->tasks.front());
+      this->tasks.pop();
+    }
+    
+    exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = current_exception();
+    }
+    
+    unique_lock<mutex> lock(this->queueMutex);
+    if (error && !this->firstError) {
+      this->firstError = error;
+    }
+    this->pendingTasks--;
+    if (this->pendingTasks == 0) {
+      this->tasksFinished.notify_all();
+    }
+  }
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+  {
+    unique_lock<mutex> lock(this->queueMutex);
+    this->tasks.push(move(task));
+    this->pendingTasks++;
+  }
+  this->taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+  unique_lock<mutex> lock(this->queueMutex);
+  this->tasksFinished.wait(lock, [this] { return this->pendingTasks == 0; });
+  if (this->firstError) {
+    exception_ptr error = this->firstError;
+    this->firstError = nullptr;
+    rethrow_exception(error);
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const function<void(size_t, size_t)> &work) {
+  size_t chunks = min(this->workers.size() + 1, max((size_t)1, count / max(minChunk, (size_t)1)));
+  size_t chunkSize = (count + chunks - 1) / max(chunks, (size_t)1);
+  size_t begin = 0;
+  for (size_t c = 0; c + 1 < chunks && begin < count; c++) {
+    size_t end = min(count, begin + chunkSize);
+    this->enqueue([&work, begin, end] { work(begin, end); });
+    begin = end;
+  }
+  if (begin < count) {
+    work(begin, count);
+  }
+  this->wait();
+}
+
+size_t ThreadPool::size() {
+  return this->workers.size();
+}
@@ -9,7 +9,8 @@
 #include <iostream>
 #include <vector>
 #include "strtk.hpp" // Import STRTK
-#include "SimpSVM.hpp"
+#include "MultiClassSVM.hpp"
+#include "SampleSelection.hpp"
 
 using namespace std;
 
@@ -69,26 +70,45 @@ int main(int argc, const char * argv[]) {
   double C = 100.0; // regularization parameter
   double TOL = 0.001; // numerical tolerance
   int MAX_PASSES = 100; // max # of times to iterate over alphas w/o changing
+  double CACHE_MB = (argc > 3) ? atof(argv[3]) : DEFAULT_SHARED_CACHE_MEGABYTES; // shared kernel cache budget
+  double MODEL_CACHE_MB = 20; // private kernel cache budget of each pairwise model
+  size_t TRAINING_BUDGET = (argc > 4) ? atoi(argv[4]) : 0; // max # of training samples, 0 = all
   
   // Read training and test sets
   vector<vector<string>> trainingSet = readTextFile(trainingSetFilename, 1);
   vector<vector<string>> testSet = readTextFile(testSetFilename, 1);
   
-  // Create feature and label vectors from ~20% of training set
+  // Create feature and label vectors from the training set
   vector<vector<int>> features;
   vector<int> labels;
   for (int i = 0; i < trainingSet.size(); i++) {
-    if (!(rand() % 5)) {
-      vector<int> feature;
-      feature.resize(trainingSet[i].size() - 1);
-      transform(trainingSet[i].begin() + 1, trainingSet[i].end(), feature.begin(), stringToBinary);
-      features.push_back(feature);
-      labels.push_back((trainingSet[i][0] == "3") ? 1 : -1);
+    vector<int> feature;
+    feature.resize(trainingSet[i].size() - 1);
+    transform(trainingSet[i].begin() + 1, trainingSet[i].end(), feature.begin(), stringToBinary);
+    features.push_back(feature);
+    labels.push_back(stoi(trainingSet[i][0]));
+  }
+  
+  // Keep the most informative samples when training on all of them would
+  // cost too much
+  if (TRAINING_BUDGET > 0 && TRAINING_BUDGET < features.size()) {
+    vector<int> kept = selectSamples(features, labels, TRAINING_BUDGET, MARGIN_SAMPLES);
+    vector<vector<int>> keptFeatures;
+    vector<int> keptLabels;
+    for (int i : kept) {
+      keptFeatures.push_back(move(features[i]));
+      keptLabels.push_back(labels[i]);
     }
+    cout << "Selected " << kept.size() << " of " << features.size() << " training samples" << endl;
+    features = move(keptFeatures);
+    labels = move(keptLabels);
   }
   
-  BinSVM svmClassifier = BinSVM(C, TOL, MAX_PASSES);
-  cout << "Beginning training w/ " << features.size() << " random samples..." << endl;
+  // One-vs-one over all of the digits, 45 binary models
+  BinSVM binaryClassifier = BinSVM(C, TOL, MAX_PASSES);
+  binaryClassifier.setCacheSize(MODEL_CACHE_MB);
+  MultiClassSVM svmClassifier = MultiClassSVM(binaryClassifier, 0, CACHE_MB);
+  cout << "Beginning training w/ " << features.size() << " samples..." << endl;
   svmClassifier.train(features, labels);
   cout << "Training complete!" << endl;
   
@@ -100,14 +120,14 @@ int main(int argc, const char * argv[]) {
     feature.resize(testSet[i].size() - 1);
     transform(testSet[i].begin() + 1, testSet[i].end(), feature.begin(), stringToBinary);
     testFeatures.push_back(feature);
-    testLabels.push_back((testSet[i][0] == "3") ? 1 : -1);
+    testLabels.push_back(stoi(testSet[i][0]));
   }
   
   // Calculate accuracy on test set
+  vector<int> predictions = svmClassifier.predictBatch(testFeatures);
   int correctCount = 0;
   for (int i = 0; i < testSet.size(); i++) {
-    int yHat = svmClassifier.predictClass(testFeatures[i]);
-    if (yHat == testLabels[i]) {
+    if (predictions[i] == testLabels[i]) {
       correctCount++;
     }
   }